@@ -0,0 +1,369 @@
+/**
+ * @file Benchmark.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <new>
+#include <opencv2/core/core.hpp>
+#include <gflags/gflags.h>
+#include "rgbd/camera/BufferPool.h"
+#include "rgbd/camera/Rotate.h"
+#include "rgbd/camera/Undistorter.h"
+#include "rgbd/camera/DepthRegistrator.h"
+#include "rgbd/camera/Stages.h"
+#include "rgbd/camera/StereoCamera.h"
+#include "rgbd/camera/SyntheticDepthCamera.h"
+#if defined(USE_DS)
+#include "rgbd/camera/DS325Calibrator.h"
+#endif
+
+using namespace rgbd;
+
+DEFINE_int32(iterations, 100, "frames measured per kernel and size");
+DEFINE_int32(warmup, 10, "frames run before measuring");
+DEFINE_string(filter, "", "run only the kernels whose name contains this");
+DEFINE_string(json, "", "file to write the results to in JSON");
+DEFINE_string(workdir, "/tmp", "directory for the generated calibration files");
+DEFINE_string(ds325_params, "data/ds325-streo-params.xml", "DS325 stereo parameters");
+DEFINE_bool(huge_pages, false, "back large frame buffers with huge pages");
+
+namespace {
+
+/**
+ * Calls of operator new in any thread, so that containers and frames
+ * allocated by the kernels are counted.
+ */
+std::atomic<uint64_t> heapAllocations(0);
+
+}
+
+void* operator new(std::size_t size) {
+    heapAllocations++;
+    void* p = std::malloc(size);
+
+    if (!p)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+/**
+ * Resolutions of the supported devices: DS325 depth, DS325 and UVC color,
+ * DS325 high resolution color, and uEye LE full frame.
+ */
+const cv::Size SIZES[] = {
+    cv::Size(320, 240), cv::Size(640, 480), cv::Size(1280, 720), cv::Size(752, 480)
+};
+
+struct Result {
+    std::string kernel;
+
+    cv::Size size;
+
+    double nsPerFrame;
+
+    double mbPerSecond;
+
+    /**
+     * operator new calls per frame.
+     */
+    double heapPerFrame;
+
+    /**
+     * Buffers the BufferPool could not recycle per frame.
+     */
+    double buffersPerFrame;
+};
+
+std::vector<Result> results;
+
+uint64_t poolMisses() {
+    BufferPool::Stats stats = BufferPool::instance().stats();
+
+    return stats.allocations - stats.hits;
+}
+
+/**
+ * Run a kernel and record how long a frame takes.
+ *
+ * @param kernel Name of the kernel
+ * @param size Size of the frames
+ * @param bytes Bytes read and written per frame
+ * @param run Kernel processing a frame
+ */
+void measure(const std::string& kernel, const cv::Size& size, size_t bytes,
+             const std::function<void()>& run) {
+    if (!FLAGS_filter.empty() && kernel.find(FLAGS_filter) == std::string::npos)
+        return;
+
+    for (int i = 0; i < FLAGS_warmup; i++)
+        run();
+
+    const uint64_t heap = heapAllocations;
+    const uint64_t misses = poolMisses();
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < FLAGS_iterations; i++)
+        run();
+
+    auto end = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    const double n = std::max(FLAGS_iterations, 1);
+
+    Result result;
+    result.kernel = kernel;
+    result.size = size;
+    result.nsPerFrame = ns / n;
+    result.mbPerSecond = ns > 0 ? bytes * n / ns * 1.0e3 : 0.0;
+    result.heapPerFrame = (heapAllocations - heap) / n;
+    result.buffersPerFrame = (poolMisses() - misses) / n;
+    results.push_back(result);
+
+    std::printf("%-20s %5dx%-5d %12.0f %10.1f %10.2f %10.2f\n", kernel.c_str(),
+                size.width, size.height, result.nsPerFrame, result.mbPerSecond,
+                result.heapPerFrame, result.buffersPerFrame);
+}
+
+/**
+ * Return an empty matrix allocated from the pool, as frames are.
+ */
+cv::Mat pooled() {
+    cv::Mat mat;
+    mat.allocator = &BufferPool::instance();
+
+    return mat;
+}
+
+cv::Mat randomDepth(const cv::Size& size) {
+    cv::Mat depth(size, CV_16U);
+    cv::randu(depth, 300, 1500);
+
+    return depth;
+}
+
+/**
+ * Write the intrinsics of a camera of the size, and the extrinsics of a
+ * copy of it 25 mm to the right, in the formats of Undistorter,
+ * DepthRegistrator and StereoCamera.
+ *
+ * @param size Size of the images
+ * @return Name of the file
+ */
+std::string writeParameters(const cv::Size& size) {
+    char file[256];
+    std::snprintf(file, sizeof (file), "%s/rgbd-bench-%dx%d.yml",
+                  FLAGS_workdir.c_str(), size.width, size.height);
+
+    const double f = size.width * 0.9;
+    cv::Mat M = (cv::Mat_<double>(3, 3) << f, 0, (size.width - 1) / 2.0,
+                                           0, f, (size.height - 1) / 2.0,
+                                           0, 0, 1);
+    cv::Mat D = (cv::Mat_<double>(1, 5) << -0.1, 0.05, 0, 0, 0);
+    cv::Mat R = cv::Mat::eye(3, 3, CV_64F);
+    cv::Mat T = (cv::Mat_<double>(3, 1) << -25.0, 0, 0);
+
+    cv::FileStorage fs(file, CV_STORAGE_WRITE);
+
+    if (!fs.isOpened()) {
+        std::cerr << "rgbd-bench: cannot write " << file << std::endl;
+        std::exit(-1);
+    }
+
+    fs << "M" << M << "D" << D << "M1" << M << "D1" << D << "M2" << M << "D2" << D
+       << "R" << R << "T" << T;
+
+    return file;
+}
+
+/**
+ * Disparity engine returning a fixed map, so that only the reprojection of
+ * StereoCamera is measured.
+ */
+class FixedDisparity: public DisparityEngine {
+public:
+    FixedDisparity(const cv::Size& size) :
+            _disparity(size, CV_16S) {
+        cv::randu(_disparity, -16, 64 * 16);
+    }
+
+    virtual void compute(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity) {
+        disparity = _disparity;
+    }
+
+    virtual int minDisparity() const {
+        return 0;
+    }
+
+private:
+    cv::Mat _disparity;
+};
+
+void benchRotate(const cv::Size& size) {
+    cv::Mat color(size, CV_8UC3);
+    cv::randu(color, 0, 256);
+    cv::Mat depth = randomDepth(size);
+    cv::Mat dst = pooled();
+
+    measure("rotate90/8UC3", size, color.total() * color.elemSize() * 2, [&] {
+        rotateImage(color, dst, 90);
+    });
+    measure("rotate180/8UC3", size, color.total() * color.elemSize() * 2, [&] {
+        rotateImage(color, dst, 180);
+    });
+    measure("rotate90/16U", size, depth.total() * depth.elemSize() * 2, [&] {
+        rotateImage(depth, dst, 90);
+    });
+}
+
+void benchUndistort(const cv::Size& size, const std::string& params) {
+    Undistorter undistorter;
+
+    if (!undistorter.load(params, size, false))
+        return;
+
+    cv::Mat color(size, CV_8UC3);
+    cv::randu(color, 0, 256);
+    cv::Mat dst = pooled();
+
+    measure("undistort/8UC3", size, color.total() * color.elemSize() * 2, [&] {
+        undistorter.undistort(color, dst);
+    });
+}
+
+void benchRegister(const cv::Size& size, const std::string& params) {
+    std::shared_ptr<DepthCamera> camera(new SyntheticDepthCamera(size, size, CV_16U, 30.0));
+    DepthRegistrator registrator(camera, params);
+    cv::Mat depth = randomDepth(size);
+    cv::Mat registered = pooled();
+
+    measure("registerDepth/16U", size, depth.total() * depth.elemSize() * 2, [&] {
+        registrator.registerDepth(depth, registered);
+    });
+}
+
+void benchPointCloud(const cv::Size& size) {
+    const double f = size.width * 0.9;
+    cv::Mat M = (cv::Mat_<double>(3, 3) << f, 0, (size.width - 1) / 2.0,
+                                           0, f, (size.height - 1) / 2.0,
+                                           0, 0, 1);
+    PointCloudStage stage("depth", "points", M, cv::Mat(), size);
+    std::shared_ptr<Frame> depth(new Frame());
+    depth->data = randomDepth(size);
+    std::vector<Frame::Ptr> inputs(1, depth);
+    std::vector<Frame::Ptr> outputs(1);
+
+    measure("pointCloudStage", size, size.area() * (2 + sizeof (cv::Point3f)), [&] {
+        outputs[0].reset();
+        stage.process(inputs, outputs);
+    });
+
+    PointCloud::Ptr cloud(new PointCloud());
+    outputs[0].reset();
+    stage.process(inputs, outputs);
+
+    measure("toPointCloud", size, size.area() * (sizeof (cv::Point3f) + sizeof (pcl::PointXYZ)), [&] {
+        StageGraph::toPointCloud(outputs[0], cloud);
+    });
+}
+
+void benchStereo(const cv::Size& size, const std::string& params) {
+    std::shared_ptr<ColorCamera> left(new SyntheticDepthCamera(size, size, CV_16U, 30.0));
+    std::shared_ptr<ColorCamera> right(new SyntheticDepthCamera(size, size, CV_16U, 30.0));
+    StereoCamera stereo(left, right, params, params);
+    stereo.setDisparityEngine(DisparityEngine::Ptr(new FixedDisparity(size)));
+    PointCloud::Ptr cloud(new PointCloud());
+
+    measure("stereoReproject", size, size.area() * (2 + sizeof (pcl::PointXYZ)), [&] {
+        stereo.capturePointCloud(cloud);
+    });
+}
+
+#if defined(USE_DS)
+void benchCalibrateDepth(const cv::Size& size) {
+    DS325CalibWorker worker(FLAGS_ds325_params);
+    cv::Mat depth = randomDepth(size);
+    cv::Mat calibrated = pooled();
+
+    measure("calibrateDepth", size, depth.total() * depth.elemSize() + 320 * 240 * 2, [&] {
+        worker.calibrateDepth(depth, calibrated);
+    });
+
+    worker.setDepthInterpolation(DS325CalibWorker::INTER_MIN_DEPTH);
+
+    measure("calibrateDepth/min", size, depth.total() * depth.elemSize() + 320 * 240 * 2, [&] {
+        worker.calibrateDepth(depth, calibrated);
+    });
+}
+#endif
+
+void writeJson(const std::string& file) {
+    std::ofstream out(file.c_str());
+
+    if (!out) {
+        std::cerr << "rgbd-bench: cannot write " << file << std::endl;
+        std::exit(-1);
+    }
+
+    out << "{\n  \"iterations\": " << FLAGS_iterations << ",\n  \"results\": [";
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << (i > 0 ? ",\n" : "\n")
+            << "    { \"kernel\": \"" << r.kernel << "\""
+            << ", \"width\": " << r.size.width
+            << ", \"height\": " << r.size.height
+            << ", \"ns_per_frame\": " << r.nsPerFrame
+            << ", \"mb_per_s\": " << r.mbPerSecond
+            << ", \"heap_allocations_per_frame\": " << r.heapPerFrame
+            << ", \"buffer_allocations_per_frame\": " << r.buffersPerFrame << " }";
+    }
+
+    out << "\n  ]\n}\n";
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+    BufferPool::instance().setHugePages(FLAGS_huge_pages);
+
+    std::printf("%-20s %11s %12s %10s %10s %10s\n", "kernel", "size", "ns/frame", "MB/s",
+                "heap/frame", "bufs/frame");
+
+    for (const cv::Size& size: SIZES) {
+        const std::string params = writeParameters(size);
+
+        benchRotate(size);
+        benchUndistort(size, params);
+        benchRegister(size, params);
+        benchPointCloud(size);
+        benchStereo(size, params);
+#if defined(USE_DS)
+        benchCalibrateDepth(size);
+#endif
+    }
+
+    if (!FLAGS_json.empty())
+        writeJson(FLAGS_json);
+
+    BufferPool::Stats stats = BufferPool::instance().stats();
+    std::printf("buffer pool: %lu allocations, %lu hits, high water %lu bytes\n",
+                (unsigned long) stats.allocations, (unsigned long) stats.hits,
+                (unsigned long) stats.highWater);
+
+    return 0;
+}
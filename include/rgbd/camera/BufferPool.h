@@ -0,0 +1,136 @@
+/**
+ * @file BufferPool.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <boost/thread/mutex.hpp>
+#include <opencv2/core/core.hpp>
+
+namespace rgbd {
+
+/**
+ * Allocator of image buffers which keeps released buffers for reuse.
+ * Sizes are rounded up to size classes, 64 bytes below a page and pages
+ * above it, so a buffer is reused by any frame of the same class. Data is
+ * aligned to 64 bytes, the cache line size, for SIMD loads and stores.
+ *
+ * Frames use the shared instance for their data, so a capture loop which
+ * recycles its frames stops calling the system allocator once it has
+ * warmed up. Any other matrix can use it as well:
+ *
+ *     cv::Mat mat;
+ *     mat.allocator = &BufferPool::instance();
+ *     mat.create(size, type);
+ */
+class BufferPool: public cv::MatAllocator {
+public:
+    /**
+     * Alignment of the data.
+     */
+    static const size_t ALIGNMENT = 64;
+
+    /**
+     * Size of a huge page.
+     */
+    static const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+    struct Stats {
+        Stats();
+
+        /**
+         * Number of buffers requested so far.
+         */
+        uint64_t allocations;
+
+        /**
+         * Number of requests served by a released buffer instead of the
+         * system allocator.
+         */
+        uint64_t hits;
+
+        /**
+         * Bytes of the buffers in use.
+         */
+        size_t bytesInUse;
+
+        /**
+         * Bytes of the released buffers kept for reuse.
+         */
+        size_t bytesCached;
+
+        /**
+         * Maximum of bytesInUse so far.
+         */
+        size_t highWater;
+    };
+
+    /**
+     * @param cacheLimit Bytes of released buffers kept at most. Buffers
+     *                   released beyond it are returned to the system.
+     */
+    BufferPool(size_t cacheLimit = 256 << 20);
+
+    virtual ~BufferPool();
+
+    /**
+     * Return the pool shared by all frames, which is never destroyed so that
+     * matrices in static objects can still release their buffers.
+     *
+     * @return Shared pool
+     */
+    static BufferPool& instance();
+
+    virtual void allocate(int dims, const int* sizes, int type, int*& refcount,
+                          uchar*& datastart, uchar*& data, size_t* step);
+
+    virtual void deallocate(int* refcount, uchar* datastart, uchar* data);
+
+    /**
+     * Back buffers of a huge page or larger with huge pages, which saves
+     * TLB misses when large frames are scanned. Explicit huge pages are
+     * tried first and transparent ones are requested if none are reserved.
+     * Only buffers allocated afterwards are affected. Cached buffers of a
+     * huge page or larger are returned to the system when the mode changes,
+     * since their sizes are rounded for the previous mode.
+     *
+     * @param enabled true to use huge pages
+     */
+    void setHugePages(bool enabled);
+
+    Stats stats() const;
+
+    /**
+     * Return the cached buffers to the system.
+     */
+    void trim();
+
+private:
+    struct Block;
+
+    size_t _cacheLimit;
+
+    bool _hugePages;
+
+    Stats _stats;
+
+    /**
+     * Released blocks by their size.
+     */
+    std::map<size_t, std::vector<Block*>> _free;
+
+    mutable boost::mutex _mutex;
+
+    size_t sizeClass(size_t bytes) const;
+
+    static Block* allocateBlock(size_t size, bool hugePages);
+
+    static void freeBlock(Block* block);
+};
+
+}
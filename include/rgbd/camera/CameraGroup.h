@@ -0,0 +1,169 @@
+/**
+ * @file CameraGroup.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <boost/thread.hpp>
+#include "DepthCamera.h"
+
+namespace rgbd {
+
+/**
+ * Cameras acquired together. Each camera gets an acquisition thread of its
+ * own, which starts the camera and then waits for its frames, and the
+ * frames of all the cameras taken at about the same time are put together
+ * into frame sets. A consumer waits for frame sets on a single condition,
+ * however many cameras there are.
+ */
+class CameraGroup {
+public:
+    /**
+     * What to drop when a frame set is ready while the queue is full.
+     */
+    enum DropPolicy {
+        /**
+         * Drop the oldest queued set, so that consumers get the latest.
+         */
+        DROP_OLDEST,
+
+        /**
+         * Drop the new set, so that consumers get every set in a burst.
+         */
+        DROP_NEWEST
+    };
+
+    /**
+     * Frames of all the cameras in the order they were added.
+     */
+    struct FrameSet {
+        FrameSet();
+
+        /**
+         * Depth frames of depth cameras and color frames of the others,
+         * whose host times are within the tolerance of each other.
+         */
+        std::vector<Frame::Ptr> frames;
+
+        /**
+         * Color frames acquired with the frames, which are empty for depth
+         * cameras without color.
+         */
+        std::vector<Frame::Ptr> colors;
+
+        /**
+         * Difference between the latest and the earliest host time of the
+         * frames in microseconds.
+         */
+        uint64_t skew;
+
+        /**
+         * Sequence number of the set, starting from 1.
+         */
+        uint64_t sequence;
+    };
+
+    /**
+     * @param tolerance Maximum difference of the host times of a set in
+     *                  microseconds
+     * @param capacity Number of sets queued for consumers
+     * @param policy What to drop when the queue is full
+     */
+    CameraGroup(uint64_t tolerance = 5000, size_t capacity = 2, DropPolicy policy = DROP_OLDEST);
+
+    virtual ~CameraGroup();
+
+    /**
+     * Add a camera, which must not be started yet. Cameras must be added
+     * before start(). Color frames are acquired with the depth frames of a
+     * depth camera only if its colorSize() is supported.
+     *
+     * @param camera Color or depth camera
+     * @param cpu CPU to pin the acquisition thread to, or -1 not to pin it.
+     *            Threads the camera starts itself inherit the CPU.
+     * @return Index of the camera in the frame sets
+     */
+    size_t add(std::shared_ptr<ColorCamera> camera, int cpu = -1);
+
+    size_t size() const;
+
+    /**
+     * Start all the cameras in parallel and their acquisition.
+     */
+    void start();
+
+    void stop();
+
+    /**
+     * Wait for the next frame set and remove it from the queue.
+     *
+     * @param set Returned frame set
+     * @param timeout Timeout in milliseconds
+     * @return true if a set is returned, false on timeout
+     */
+    bool waitForNextSet(FrameSet& set, int timeout);
+
+    /**
+     * Return the number of frames dropped so far, either because no frame
+     * of another camera matched them or because the queue was full.
+     *
+     * @return Number of frames
+     */
+    uint64_t dropped() const;
+
+private:
+    /**
+     * Frames waiting for the frames of the other cameras.
+     */
+    static const size_t MAX_PENDING = 8;
+
+    struct Member {
+        std::shared_ptr<ColorCamera> camera;
+
+        std::shared_ptr<DepthCamera> depth;
+
+        /**
+         * true if color frames are acquired with the frames of the camera.
+         */
+        bool color;
+
+        int cpu;
+
+        std::deque<std::pair<Frame::Ptr, Frame::Ptr>> pending;
+    };
+
+    std::vector<Member> _members;
+
+    uint64_t _tolerance;
+
+    size_t _capacity;
+
+    DropPolicy _policy;
+
+    std::deque<FrameSet> _sets;
+
+    uint64_t _sequence;
+
+    uint64_t _dropped;
+
+    volatile bool _running;
+
+    boost::thread_group _threads;
+
+    mutable boost::mutex _mutex;
+
+    boost::condition_variable _condition;
+
+    void acquire(size_t index);
+
+    void push(size_t index, const Frame::Ptr& frame, const Frame::Ptr& color);
+
+    void assemble();
+};
+
+}
@@ -22,6 +22,17 @@ public:
 
     virtual void start();
 
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
+    virtual void setTriggerMode(TriggerMode mode);
+
+    virtual void trigger();
+
+    /**
+     * Estimate the white balance from an image of a gray target.
+     *
+     * @param gray Image of CV_8UC3
+     */
     virtual void setGrayImage(cv::Mat& gray);
 
     virtual void captureColor(cv::Mat& buffer);
@@ -34,6 +45,12 @@ private:
     double _rscale;
 
     double _bscale;
+
+    /**
+     * Per-channel lookup table of the white balance, so that a frame is
+     * corrected in a single pass.
+     */
+    cv::Mat _lut;
 };
 
 }
@@ -11,11 +11,24 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "rgbd/common/Error.h"
+#include "Frame.h"
 
 namespace rgbd {
 
 class ColorCamera {
 public:
+    /**
+     * How the device decides when to expose a frame.
+     */
+    enum TriggerMode {
+        /** Expose frames continuously at the device frame rate. */
+        FREE_RUN,
+        /** Expose a frame each time trigger() is called. */
+        SOFTWARE_TRIGGER,
+        /** Expose a frame on a signal at the trigger input of the device. */
+        HARDWARE_TRIGGER
+    };
+
     ColorCamera();
 
     virtual ~ColorCamera();
@@ -32,13 +45,61 @@ public:
      */
     virtual void start();
 
+    /**
+     * Block until a frame newer than the one the consumer has seen arrives,
+     * so that each frame is processed once. Each consumer keeps its own
+     * sequence, so consumers do not take new frames away from each other.
+     * Cameras without a device thread return true immediately.
+     *
+     * @param sequence Sequence number of the frame the consumer has seen
+     *                 last, or 0 at first. Set to the one of the new frame,
+     *                 which is a depth frame for depth cameras.
+     * @param timeout Timeout in milliseconds
+     * @return true if a new frame is available, false on timeout
+     */
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
+    /**
+     * Select how the device is triggered. The mode may be set before or
+     * after start().
+     *
+     * @param mode Trigger mode
+     */
+    virtual void setTriggerMode(TriggerMode mode);
+
+    /**
+     * Expose a single frame in SOFTWARE_TRIGGER mode. The frame is
+     * delivered asynchronously, use waitForNextFrame() to receive it.
+     */
+    virtual void trigger();
+
     /**
      * Copy the latest color data to the buffer.
      * Note that the buffer must be allocated in advance.
+     * The buffer is left as it is if no frame has arrived yet, and so are
+     * the buffers of the cameras wrapping this one, which capture from
+     * acquireColorFrame().
      *
      * @param buffer Returned matrix of CV_8UC3
      */
     virtual void captureColor(cv::Mat& buffer);
+
+    /**
+     * Return the latest color frame without copying it.
+     * The frame is shared with the device and must not be modified.
+     *
+     * @return Frame of CV_8UC3, or an empty pointer if no frame has arrived yet
+     */
+    virtual Frame::Ptr acquireColorFrame();
+
+private:
+    /**
+     * Frames returned by the default acquireColorFrame(), recycled once
+     * the consumers release them.
+     */
+    FramePool _colorFrames;
+
+    boost::mutex _framesMutex;
 };
 
 }
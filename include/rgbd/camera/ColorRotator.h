@@ -22,6 +22,12 @@ public:
 
     virtual void start();
 
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
+    virtual void setTriggerMode(TriggerMode mode);
+
+    virtual void trigger();
+
     virtual void captureColor(cv::Mat& buffer);
 
     virtual void captureRawColor(cv::Mat& buffer);
@@ -31,8 +37,6 @@ protected:
 
     cv::Size _csize;
 
-    cv::Mat _cbuffer;
-
     const int _angle;
 };
 
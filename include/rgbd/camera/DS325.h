@@ -10,7 +10,9 @@
 #include <cstdio>
 #include <boost/thread/thread.hpp>
 #include <DepthSense.hxx>
+#include "rgbd/common/TripleBuffer.h"
 #include "DepthCamera.h"
+#include "Metrics.h"
 
 using namespace DepthSense;
 
@@ -30,16 +32,38 @@ public:
 
     virtual void start();
 
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
     virtual void captureDepth(cv::Mat& buffer);
 
     virtual void captureAmplitude(cv::Mat& buffer);
 
     virtual void captureColor(cv::Mat& buffer);
 
+    virtual Frame::Ptr acquireDepthFrame();
+
+    virtual Frame::Ptr acquireAmplitudeFrame();
+
+    virtual Frame::Ptr acquireColorFrame();
+
     virtual void capturePointCloud(PointCloud::Ptr buffer);
 
+    /**
+     * Copy the latest colored 3D point cloud data to the buffer.
+     * The buffer is kept organized in the depth image size, and points
+     * without a color pixel are set to NaN.
+     *
+     * @param buffer Returned pcl::PointCloud<pcl::PointXYZRGB>::Ptr
+     */
     virtual void captureColoredPointCloud(ColoredPointCloud::Ptr buffer);
 
+    /**
+     * Set how the color of each point is sampled.
+     *
+     * @param interpolation cv::INTER_NEAREST (default) or cv::INTER_LINEAR
+     */
+    virtual void setColorInterpolation(int interpolation);
+
     /**
      * Copy the latest audio data to the buffer.
      * Note that the buffer must be allocated in advance.
@@ -64,12 +88,39 @@ protected:
 
     cv::Size _csize;
 
+    /**
+     * Serializes consumers of _dsamples. The SDK thread never takes it.
+     */
     boost::mutex _dmutex;
 
-    boost::mutex _cmutex;
-
     boost::mutex _amutex_;
 
+    FramePool _dframes;
+
+    FramePool _aframes;
+
+    FramePool _cframes;
+
+    uint64_t _ddropped;
+
+    uint64_t _cdropped;
+
+    Histogram* _dcopy;
+
+    Histogram* _ccopy;
+
+    Histogram* _vcopy;
+
+    Histogram* _vlockWait;
+
+    Counter* _ddeviceDropped;
+
+    Counter* _cdeviceDropped;
+
+    int _interpolation;
+
+    std::vector<int> _offsets;
+
     virtual void onNewDepthSample(DepthNode node, DepthNode::NewSampleReceivedData data);
 
     virtual void onNewColorSample(ColorNode node, ColorNode::NewSampleReceivedData data);
@@ -77,9 +128,20 @@ protected:
     virtual void onNewAudioSample(AudioNode node, AudioNode::NewSampleReceivedData data);
 
 private:
-    DepthNode::NewSampleReceivedData _ddata;
+    /**
+     * Owned copy of the per-sample data which has no frame of its own.
+     */
+    struct DepthSample {
+        std::vector<FPVertex> vertices;
+
+        std::vector<UV> uvMap;
+
+        cv::Point3f acceleration;
+
+        FrameInfo info;
+    };
 
-    ColorNode::NewSampleReceivedData _cdata;
+    TripleBuffer<DepthSample> _dsamples;
 
     AudioNode::NewSampleReceivedData _adata;
 
@@ -15,17 +15,43 @@ namespace rgbd {
 
 class DS325CalibWorker {
 public:
+    /**
+     * Depth interpolation which takes the nearest valid depth among the four
+     * neighboring pixels.
+     */
+    static const int INTER_MIN_DEPTH = 100;
+
     DS325CalibWorker(const std::string& params);
 
     ~DS325CalibWorker();
 
-    void calibrateColor(cv::Mat &source, cv::Mat &result);
+    /**
+     * The crop, resize and remap steps of each stream are composed into a
+     * single remap table, so that a frame is calibrated in one pass.
+     * The source and result must not be the same.
+     */
+    void calibrateColor(const cv::Mat &source, cv::Mat &result);
+
+    void calibrateDepth(const cv::Mat &source, cv::Mat &result);
 
-    void calibrateDepth(cv::Mat &source, cv::Mat &result);
+    void calibrateAmplitude(const cv::Mat &source, cv::Mat &result);
 
-    void calibrateAmplitude(cv::Mat &source, cv::Mat &result);
+    /**
+     * Set how depth is interpolated. Linear interpolation blends foreground
+     * and background at edges into flying pixels, which the other modes avoid.
+     *
+     * @param interpolation cv::INTER_LINEAR (default), cv::INTER_NEAREST or
+     *                      INTER_MIN_DEPTH
+     */
+    void setDepthInterpolation(int interpolation);
 
 private:
+    /**
+     * Region of the depth image resized to the color size which the color
+     * image covers, measured for the DS325.
+     */
+    static const cv::Rect DEPTH_CROP;
+
     cv::Size _csize;
 
     cv::Size _dsize;
@@ -36,9 +62,28 @@ private:
 
     cv::Mat _rectifyMaps[2][2];
 
+    cv::Mat _colorMaps[2];
+
+    cv::Mat _depthMaps[2];
+
+    cv::Mat _depthNearest;
+
+    /**
+     * Depth clamped to the maximum depth before it is remapped.
+     */
+    cv::Mat _clamped;
+
+    int _interpolation;
+
+    cv::Size _depthSource;
+
     cv::Rect validROI[2];
 
     void loadParameters(const std::string& params);
+
+    void buildColorMaps();
+
+    void buildDepthMaps(const cv::Size& source);
 };
 
 class DS325Calibrator: public DepthCalibrator {
@@ -53,6 +98,11 @@ public:
 
     virtual void captureAmplitude(cv::Mat& buffer);
 
+    /**
+     * @see DS325CalibWorker::setDepthInterpolation
+     */
+    virtual void setDepthInterpolation(int interpolation);
+
     virtual void capturePointCloud(PointCloud::Ptr buffer);
 
 private:
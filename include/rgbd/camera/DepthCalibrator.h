@@ -22,6 +22,8 @@ public:
 
     virtual void start();
 
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
     virtual void captureRawColor(cv::Mat& buffer);
 
     virtual void captureRawDepth(cv::Mat& buffer);
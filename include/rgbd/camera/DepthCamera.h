@@ -34,8 +34,26 @@ public:
 
     virtual void start();
 
+    /**
+     * Block until a depth frame newer than the one the consumer has seen
+     * arrives. Consumers of color only wait for depth frames as well, which
+     * arrive at least as often on the supported devices.
+     *
+     * @param sequence Sequence number of the depth frame the consumer has
+     *                 seen last, or 0 at first
+     * @param timeout Timeout in milliseconds
+     * @return true if a new frame is available, false on timeout
+     */
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
+    virtual void setTriggerMode(TriggerMode mode);
+
+    virtual void trigger();
+
     virtual void captureColor(cv::Mat& buffer);
 
+    virtual Frame::Ptr acquireColorFrame();
+
     /**
      * Return the size of depth image.
      *
@@ -46,22 +64,49 @@ public:
     /**
      * Copy the latest depth data to the buffer.
      * Note that the buffer must be allocated in advance.
+     * The buffer is left as it is if no frame has arrived yet, and so are
+     * the buffers of the cameras wrapping this one, which capture from
+     * acquireDepthFrame().
      *
      * @param buffer Returned cv::Mat of CV_32F
      */
     virtual void captureDepth(cv::Mat& buffer);
 
+    /**
+     * Return the latest depth frame without copying it.
+     * The frame is shared with the device and must not be modified.
+     * Cameras without a device thread return a copy made by captureDepth().
+     *
+     * @return Frame of the same type as captureDepth(), or an empty pointer
+     *         if no frame has arrived yet
+     */
+    virtual Frame::Ptr acquireDepthFrame();
+
     /**
      * Copy the latest amplitude data to the buffer.
      * Note that the buffer must be allocated in advance.
+     * The buffer is left as it is if no frame has arrived yet, as for
+     * captureDepth().
      *
      * @param buffer Returned cv::Mat of CV_32F
      */
     virtual void captureAmplitude(cv::Mat& buffer);
 
+    /**
+     * Return the latest amplitude frame without copying it.
+     * The frame is shared with the device and must not be modified.
+     * Cameras without a device thread return a copy made by captureAmplitude().
+     *
+     * @return Frame of the same type as captureAmplitude(), or an empty
+     *         pointer if no frame has arrived yet
+     */
+    virtual Frame::Ptr acquireAmplitudeFrame();
+
     /**
      * Copy the latest 3D point cloud data to the buffer.
      * Note that the buffer must be allocated in advance.
+     * The header stamp and seq are set to the host time and sequence number
+     * of the depth frame the cloud comes from.
      *
      * @param buffer Returned pcl::PointCloud<pcl::PointXYZ>::Ptr
      */
@@ -70,13 +115,33 @@ public:
     /**
      * Copy the latest colored 3D point cloud data to the buffer.
      * Note that the buffer must be allocated in advance.
+     * The header is set in the same way as capturePointCloud().
      *
      * @param buffer Returned pcl::PointCloud<pcl::PointXYZRGB>::Ptr
      */
     virtual void captureColoredPointCloud(ColoredPointCloud::Ptr buffer);
 
+protected:
+    /**
+     * Stamp the point cloud header with the frame information.
+     *
+     * @param header Header of the point cloud
+     * @param info Information of the depth frame
+     */
+    static void stampHeader(pcl::PCLHeader& header, const FrameInfo& info);
+
 private:
     std::shared_ptr<ColorCamera> _camera;
+
+    /**
+     * Frames returned by the default acquireDepthFrame() and
+     * acquireAmplitudeFrame(), recycled once the consumers release them.
+     */
+    FramePool _depthFrames;
+
+    FramePool _amplitudeFrames;
+
+    boost::mutex _framesMutex;
 };
 
 }
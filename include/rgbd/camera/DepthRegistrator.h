@@ -0,0 +1,170 @@
+/**
+ * @file DepthRegistrator.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <boost/thread/mutex.hpp>
+#include "DepthCalibrator.h"
+
+namespace rgbd {
+
+/**
+ * Registration of depth to the color image. Each depth pixel is projected
+ * into the color camera and drawn as a small square, and a z-buffer keeps
+ * the nearest depth where squares overlap, so that the background does not
+ * show through the foreground at occlusion edges.
+ */
+class DepthRegistrator: public DepthCalibrator {
+public:
+    /**
+     * @param camera Depth camera with a color camera
+     * @param params Stereo parameters readable by cv::FileStorage: M1 and D1
+     *               of the color camera, M2 and D2 of the depth camera, both
+     *               at their native sizes, and R and T mapping points from
+     *               the color camera to the depth camera as cv::stereoCalibrate
+     *               returns them. data/ds325-streo-params.xml is calibrated
+     *               on the depth DS325Calibrator crops and upscales, so
+     *               DS325 takes data/ds325-registration-params.xml instead,
+     *               whose M2 is converted to the native 320x240 depth. Its
+     *               M1 is valid for the 640x480 color of FRAME_FORMAT_VGA
+     *               only, not for the default FRAME_FORMAT_WXGA_H. Exits if
+     *               the principal point of M1 does not fit the color size.
+     * @param depthUnit Length of a depth value in meters
+     * @param translationUnit Length of a unit of T in meters
+     * @param maxDepth Largest valid depth value. Larger values are not
+     *                 projected, such as the saturated and low confidence
+     *                 codes 32001 and 32002 of DS325 by default.
+     */
+    DepthRegistrator(std::shared_ptr<DepthCamera> camera, const std::string& params,
+                     float depthUnit = 0.001f, float translationUnit = 0.001f,
+                     float maxDepth = 32000.0f);
+
+    virtual ~DepthRegistrator();
+
+    /**
+     * Return the size of registered depth image, which is the size of color
+     * image.
+     *
+     * @return Size of color image
+     */
+    virtual cv::Size depthSize() const;
+
+    virtual void captureColor(cv::Mat& buffer);
+
+    virtual Frame::Ptr acquireColorFrame();
+
+    /**
+     * Copy the latest depth registered to the color image.
+     *
+     * @param buffer Returned cv::Mat of the type and unit of the raw depth,
+     *               holding 0 where no depth is projected
+     */
+    virtual void captureDepth(cv::Mat& buffer);
+
+    /**
+     * Return the latest depth frame registered to the color image. It
+     * carries the timing information of the raw depth frame.
+     *
+     * @return Frame of the type of the raw depth, or an empty pointer if no
+     *         frame has arrived yet
+     */
+    virtual Frame::Ptr acquireDepthFrame();
+
+    /**
+     * Copy the latest registered depth as an organized point cloud of the
+     * size of color image, in meters in the color camera coordinates.
+     * Pixels without depth are NaN.
+     *
+     * @param buffer Returned pcl::PointCloud<pcl::PointXYZ>::Ptr
+     */
+    virtual void capturePointCloud(PointCloud::Ptr buffer);
+
+    /**
+     * Copy the latest registered depth as an organized point cloud colored
+     * by the latest color frame.
+     *
+     * @param buffer Returned pcl::PointCloud<pcl::PointXYZRGB>::Ptr
+     */
+    virtual void captureColoredPointCloud(ColoredPointCloud::Ptr buffer);
+
+    /**
+     * Register a depth image to the color image.
+     *
+     * @param depth Raw depth of CV_16U or CV_32F
+     * @param registered Returned depth of the size of color image and the
+     *                   type of the raw depth
+     */
+    void registerDepth(const cv::Mat& depth, cv::Mat& registered);
+
+private:
+    cv::Size _csize;
+
+    cv::Size _dsize;
+
+    float _depthUnit;
+
+    /**
+     * Largest valid depth in meters.
+     */
+    float _maxDepth;
+
+    /**
+     * Rotation and translation in meters from the depth camera to the color
+     * camera.
+     */
+    cv::Matx33f _rotation;
+
+    cv::Vec3f _translation;
+
+    /**
+     * fx, fy, cx and cy followed by the eight distortion coefficients of the
+     * color camera.
+     */
+    float _color[12];
+
+    /**
+     * Squared radius in normalized coordinates beyond which projected points
+     * are outside the color image, where the distortion model folds back.
+     */
+    float _maxRadius2;
+
+    /**
+     * Side of the square each depth pixel is drawn as.
+     */
+    int _splat;
+
+    /**
+     * Normalized undistorted coordinates of the depth and color pixels.
+     */
+    cv::Mat _depthRays[2];
+
+    cv::Mat _colorRays[2];
+
+    cv::Mat _meters;
+
+    cv::Mat _targets;
+
+    cv::Mat _zs;
+
+    cv::Mat _zbuffer;
+
+    boost::mutex _mutex;
+
+    /**
+     * Frames returned by acquireDepthFrame().
+     */
+    FramePool _frames;
+
+    boost::mutex _framesMutex;
+
+    void loadParameters(const std::string& params, float translationUnit);
+
+    void buildZBuffer(const cv::Mat& depth);
+};
+
+}
@@ -6,7 +6,7 @@
 
 #pragma once
 
-#include <pcl/common/transforms.h>
+#include <algorithm>
 #include "rgbd/camera/DepthCamera.h"
 #include "rgbd/camera/ColorRotator.h"
 
@@ -24,6 +24,8 @@ public:
 
     virtual void start();
 
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
     virtual void captureColor(cv::Mat& buffer);
 
     virtual void captureRawColor(cv::Mat& buffer);
@@ -36,6 +38,12 @@ public:
 
     virtual void captureRawAmplitude(cv::Mat& buffer);
 
+    /**
+     * Capture the point cloud rotated about the z axis. Organized clouds
+     * are reordered, so that their width and height match depthSize().
+     *
+     * @param buffer Returned point cloud
+     */
     virtual void capturePointCloud(PointCloud::Ptr buffer);
 
     virtual void captureRawVertex(PointCloud::Ptr buffer);
@@ -49,11 +57,9 @@ protected:
 
     cv::Size _dsize;
 
-    cv::Mat _dbuffer;
-
-    cv::Mat _abuffer;
+    PointCloud _vscratch;
 
-    Eigen::Matrix4f _rotation;
+    ColoredPointCloud _cscratch;
 };
 
 }
@@ -0,0 +1,145 @@
+/**
+ * @file DisparityEngine.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/calib3d/calib3d.hpp>
+
+namespace rgbd {
+
+/**
+ * Disparity computation of rectified stereo images.
+ */
+class DisparityEngine {
+public:
+    typedef std::shared_ptr<DisparityEngine> Ptr;
+
+    virtual ~DisparityEngine();
+
+    /**
+     * Compute the disparity of the left image.
+     *
+     * @param left Rectified left image of CV_8UC3
+     * @param right Rectified right image of CV_8UC3
+     * @param disparity Returned disparity of CV_16S multiplied by 16
+     */
+    virtual void compute(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity) = 0;
+
+    /**
+     * Return the minimum disparity. Pixels without a match are marked with a
+     * smaller disparity.
+     *
+     * @return Minimum disparity
+     */
+    virtual int minDisparity() const = 0;
+
+    /**
+     * Create an engine from a configuration file readable by cv::FileStorage.
+     * The "engine" entry selects "sgbm", "bm" or "tiled-sgbm", and the other
+     * entries are named after the OpenCV parameters they override.
+     *
+     * @param file Configuration file
+     * @return Engine, or an empty pointer if the file is invalid
+     */
+    static Ptr create(const std::string& file);
+
+    /**
+     * Create an engine from a node of a configuration file.
+     *
+     * @param node Node holding the engine entries
+     * @return Engine, or an empty pointer if the engine is unknown
+     */
+    static Ptr create(const cv::FileNode& node);
+};
+
+/**
+ * Semi-global block matching over the whole image.
+ */
+class SGBMEngine: public DisparityEngine {
+public:
+    SGBMEngine();
+
+    SGBMEngine(const cv::FileNode& node);
+
+    virtual ~SGBMEngine();
+
+    virtual void compute(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity);
+
+    virtual int minDisparity() const;
+
+    /**
+     * Return the matcher to change its parameters.
+     *
+     * @return Matcher
+     */
+    cv::StereoSGBM& sgbm();
+
+protected:
+    cv::StereoSGBM _sgbm;
+};
+
+/**
+ * Block matching, which is the fastest but leaves textureless regions empty.
+ */
+class BMEngine: public DisparityEngine {
+public:
+    BMEngine();
+
+    BMEngine(const cv::FileNode& node);
+
+    virtual ~BMEngine();
+
+    virtual void compute(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity);
+
+    virtual int minDisparity() const;
+
+    /**
+     * Return the matcher to change its parameters.
+     *
+     * @return Matcher
+     */
+    cv::StereoBM& bm();
+
+private:
+    cv::StereoBM _bm;
+
+    cv::Mat _lgray, _rgray;
+};
+
+/**
+ * Semi-global block matching over horizontal bands processed in parallel.
+ * Neighboring bands overlap, so that the matching costs aggregated along
+ * vertical paths are cut off only far from the rows kept from each band.
+ */
+class TiledSGBMEngine: public SGBMEngine {
+public:
+    /**
+     * @param bands Number of bands, or 0 for the number of threads
+     * @param overlap Number of rows shared by neighboring bands
+     */
+    TiledSGBMEngine(int bands = 0, int overlap = 16);
+
+    TiledSGBMEngine(const cv::FileNode& node);
+
+    virtual ~TiledSGBMEngine();
+
+    virtual void compute(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity);
+
+private:
+    int _bands;
+
+    int _overlap;
+
+    std::vector<cv::StereoSGBM> _matchers;
+
+    std::vector<cv::Mat> _disparities;
+};
+
+}
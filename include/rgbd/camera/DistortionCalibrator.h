@@ -8,7 +8,9 @@
 
 #include <iostream>
 #include <memory>
+#include <boost/thread/mutex.hpp>
 #include "ColorCamera.h"
+#include "Undistorter.h"
 
 namespace rgbd {
 
@@ -23,14 +25,32 @@ public:
 
     virtual void start();
 
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
+    virtual void setTriggerMode(TriggerMode mode);
+
+    virtual void trigger();
+
     virtual void captureColor(cv::Mat& buffer);
 
+    /**
+     * Return the undistorted latest color frame. Its buffer is recycled once
+     * released, and it carries the timing information of the raw frame.
+     *
+     * @return Frame of CV_8UC3, or an empty pointer if no frame has arrived yet
+     */
+    virtual Frame::Ptr acquireColorFrame();
+
     virtual void captureRawColor(cv::Mat& buffer);
 
 private:
     std::shared_ptr<ColorCamera> _camera;
 
-    cv::Mat _rectifyMaps[2];
+    Undistorter _undistorter;
+
+    FramePool _frames;
+
+    boost::mutex _mutex;
 };
 
 }
@@ -0,0 +1,191 @@
+/**
+ * @file Frame.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <opencv2/core/core.hpp>
+
+namespace rgbd {
+
+class Histogram;
+
+class Counter;
+
+/**
+ * Timing information attached to a frame.
+ */
+struct FrameInfo {
+    FrameInfo();
+
+    /**
+     * Return the monotonic host time.
+     *
+     * @return Time in microseconds
+     */
+    static uint64_t now();
+
+    /**
+     * Timestamp given by the device in microseconds, or 0 if unavailable.
+     */
+    uint64_t deviceTime;
+
+    /**
+     * Monotonic host time in microseconds when the frame was received.
+     */
+    uint64_t hostTime;
+
+    /**
+     * Sequence number of the frame in its stream, starting from 1.
+     */
+    uint64_t sequence;
+
+    /**
+     * Number of frames the device has dropped so far.
+     */
+    uint64_t dropped;
+};
+
+/**
+ * Image frame shared between a device thread and its consumers.
+ * A published frame is never written again, so consumers can read it
+ * without copying for as long as they hold the pointer.
+ *
+ * The data is allocated from BufferPool::instance(), as long as it is
+ * created in place rather than assigned from another matrix.
+ */
+class Frame {
+public:
+    typedef std::shared_ptr<const Frame> Ptr;
+
+    Frame();
+
+    Frame(const cv::Size& size, int type);
+
+    cv::Mat data;
+
+    FrameInfo info;
+};
+
+/**
+ * Pool of recycled frames which also keeps the latest published one.
+ * A frame is handed out again by allocate() only after every consumer
+ * has released it, so steady-state capture does not reallocate.
+ *
+ * The pool has no capacity limit: allocate() adds a frame whenever all of
+ * them are held, so it grows to the number of frames consumers hold at
+ * once plus two, the latest one and the one being written, and it never
+ * shrinks. Consumers holding on to frames therefore cost memory instead of
+ * dropped frames, and frames() tells how many have been needed.
+ *
+ * allocate(), frames() and publish() must be called from the producer
+ * thread only, latest() and waitForNext() may be called from any thread.
+ */
+class FramePool {
+public:
+    /**
+     * @param reserved Number of frames to reserve room for, which only
+     *                 saves reallocating the list of frames while it grows
+     */
+    FramePool(size_t reserved = 3);
+
+    virtual ~FramePool();
+
+    /**
+     * Return a frame which is referenced by nobody but the pool.
+     * Its data is (re)allocated only if the size or type differs.
+     *
+     * @param size Size of the frame
+     * @param type OpenCV type of the frame
+     * @return Writable frame
+     */
+    std::shared_ptr<Frame> allocate(const cv::Size& size, int type);
+
+    /**
+     * Return a frame which is referenced by nobody but the pool, keeping its
+     * data as it is, for producers which create the data themselves.
+     *
+     * @return Writable frame
+     */
+    std::shared_ptr<Frame> allocate();
+
+    /**
+     * Return the number of frames the pool has allocated so far.
+     *
+     * @return Number of frames
+     */
+    size_t frames() const;
+
+    /**
+     * Make the frame the latest one and assign its sequence number.
+     *
+     * @param frame Frame returned by allocate()
+     */
+    void publish(const std::shared_ptr<Frame>& frame);
+
+    /**
+     * Return the latest published frame, which counts it as consumed in the
+     * metrics.
+     *
+     * @return Latest frame, or an empty pointer if nothing has been published
+     */
+    Frame::Ptr latest() const;
+
+    /**
+     * Block until a frame newer than the sequence is published. Each consumer
+     * keeps its own sequence, so every consumer sees every frame regardless
+     * of the others.
+     *
+     * @param sequence Sequence number of the frame the consumer has seen
+     *                 last, or 0 at first. Set to the one of the latest frame
+     *                 if a new frame is available.
+     * @param timeout Timeout in milliseconds
+     * @return true if a new frame is available, false on timeout
+     */
+    bool waitForNext(uint64_t& sequence, int timeout) const;
+
+    /**
+     * Record the frames into the metrics of the stream, which are named
+     * after it, e.g. "ds325.0.depth.produced". Nothing is recorded until
+     * this is called.
+     *
+     * @param name Name of the stream
+     * @see Metrics
+     */
+    void instrument(const std::string& name);
+
+private:
+    std::vector<std::shared_ptr<Frame>> _frames;
+
+    Frame::Ptr _latest;
+
+    uint64_t _sequence;
+
+    mutable uint64_t _consumed;
+
+    mutable boost::mutex _mutex;
+
+    mutable boost::condition_variable _condition;
+
+    Counter* _produced;
+
+    Counter* _consumedFrames;
+
+    Counter* _dropped;
+
+    Histogram* _interval;
+
+    Histogram* _lockWait;
+
+    uint64_t _published;
+};
+
+}
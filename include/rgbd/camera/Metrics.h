@@ -0,0 +1,194 @@
+/**
+ * @file Metrics.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <map>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include <boost/thread.hpp>
+
+namespace rgbd {
+
+/**
+ * Histogram of durations in nanoseconds, which any number of threads may
+ * record into without locking. Each power of two is split into four
+ * buckets, so percentiles are accurate to 25%.
+ */
+class Histogram {
+public:
+    static const int BUCKETS = 256;
+
+    Histogram();
+
+    void record(uint64_t ns);
+
+    uint64_t count() const;
+
+    uint64_t sum() const;
+
+    uint64_t max() const;
+
+    double mean() const;
+
+    /**
+     * Return the duration below which the fraction of the recorded ones lies.
+     *
+     * @param fraction Fraction between 0 and 1
+     * @return Upper bound of the bucket of the percentile in nanoseconds
+     */
+    uint64_t percentile(double fraction) const;
+
+    void reset();
+
+private:
+    std::atomic<uint64_t> _buckets[BUCKETS];
+
+    std::atomic<uint64_t> _count;
+
+    std::atomic<uint64_t> _sum;
+
+    std::atomic<uint64_t> _max;
+
+    static int bucket(uint64_t ns);
+
+    static uint64_t upperBound(int bucket);
+};
+
+/**
+ * Counter which any number of threads may add to without locking.
+ */
+class Counter {
+public:
+    Counter();
+
+    void add(uint64_t n = 1);
+
+    uint64_t value() const;
+
+    void reset();
+
+private:
+    std::atomic<uint64_t> _value;
+};
+
+/**
+ * Named histograms and counters of the capture paths. Names are made of
+ * the stream and the quantity, e.g. "ds325.0.depth.copy", with the quantities
+ *
+ * - produced, consumed, dropped: frames published by the device thread,
+ *   returned to consumers, and replaced before any consumer took them
+ * - device_dropped: frames the device reports it has dropped
+ * - interval: time between frames published
+ * - lock_wait: time spent waiting for the lock of the frames or the stage
+ * - copy: time spent copying frames
+ * - process: time spent processing frames
+ *
+ * Devices name their streams after the device and its number, e.g.
+ * "ueye.1.color", or the order they were opened in if the device has no
+ * number, e.g. "pmd.0.depth". Cameras wrapping another one name them after
+ * their class, e.g. "rotator.depth.process", which all instances of the
+ * class share.
+ *
+ * Histograms and counters are created on first use and never destroyed,
+ * so the references returned can be kept for the hot paths.
+ */
+class Metrics {
+public:
+    enum Format {
+        TEXT,
+        JSON
+    };
+
+    static Metrics& instance();
+
+    /**
+     * Return the monotonic time used for the durations.
+     *
+     * @return Time in nanoseconds
+     */
+    static uint64_t now();
+
+    Histogram& histogram(const std::string& name);
+
+    Counter& counter(const std::string& name);
+
+    /**
+     * Write all histograms and counters. Text shows durations in
+     * microseconds, JSON in nanoseconds.
+     *
+     * @param out Stream to write to
+     * @param format TEXT or JSON
+     */
+    void write(std::ostream& out, Format format) const;
+
+    /**
+     * Write all histograms and counters to a file, replacing it at once
+     * so that readers never see a partial file.
+     *
+     * @param file File to write to
+     * @param format TEXT or JSON
+     * @return true if the file is written
+     */
+    bool write(const std::string& file, Format format) const;
+
+    /**
+     * Write to a file periodically in a thread of its own, until stopDump().
+     *
+     * @param file File to write to
+     * @param period Period in milliseconds
+     * @param format TEXT or JSON
+     */
+    void startDump(const std::string& file, int period, Format format = JSON);
+
+    void stopDump();
+
+    /**
+     * Clear all histograms and counters.
+     */
+    void reset();
+
+private:
+    Metrics();
+
+    ~Metrics();
+
+    std::map<std::string, std::unique_ptr<Histogram>> _histograms;
+
+    std::map<std::string, std::unique_ptr<Counter>> _counters;
+
+    mutable boost::mutex _mutex;
+
+    boost::thread _dumper;
+
+    bool _dumping;
+
+    boost::mutex _dumpMutex;
+
+    boost::condition_variable _dumpCondition;
+
+    void dump(std::string file, int period, Format format);
+};
+
+/**
+ * Record the lifetime of the timer into a histogram.
+ */
+class ScopedTimer {
+public:
+    ScopedTimer(Histogram& histogram);
+
+    ~ScopedTimer();
+
+private:
+    Histogram& _histogram;
+
+    const uint64_t _start;
+};
+
+}
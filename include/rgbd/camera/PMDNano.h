@@ -13,6 +13,7 @@
 #include <boost/bind.hpp>
 #include <boost/thread/thread.hpp>
 #include "DepthCamera.h"
+#include "Metrics.h"
 
 namespace rgbd {
 
@@ -27,17 +28,23 @@ public:
 
     virtual void start();
 
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
     virtual void captureDepth(cv::Mat& buffer);
 
+    virtual Frame::Ptr acquireDepthFrame();
+
+    virtual Frame::Ptr acquireAmplitudeFrame();
+
     virtual void captureAmplitude(cv::Mat& buffer);
 
     virtual void capturePointCloud(PointCloud::Ptr buffer);
 
 protected:
-    boost::mutex _mutex;
-
     volatile bool _running;
 
+    boost::thread _thread;
+
     size_t _width;
 
     size_t _height;
@@ -50,9 +57,13 @@ protected:
 
     char* _source;
 
-    float* _buffer;
+    FramePool _dframes;
+
+    FramePool _aframes;
+
+    FramePool _vframes;
 
-    float* _vbuffer;
+    Histogram* _copy;
 
     void update();
 
@@ -0,0 +1,182 @@
+/**
+ * @file Recorder.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <cstdint>
+#include <boost/thread.hpp>
+#include "DepthCamera.h"
+
+namespace rgbd {
+
+/**
+ * Layout of a recording, in the byte order of the recording host.
+ *
+ * A recording starts with a RecordHeader and continues with chunks, each a
+ * ChunkHeader followed by the pixels of one frame in row order. Headers and
+ * pixels start at multiples of RECORD_ALIGNMENT, so that a mapped recording
+ * can be read in place. A closed recording ends with the offsets of all
+ * chunks and a RecordFooter, which a recording cut off by a crash lacks and
+ * is then indexed by walking the chunks.
+ */
+namespace record {
+
+const size_t RECORD_ALIGNMENT = 64;
+
+const char RECORD_MAGIC[8] = { 'R', 'G', 'B', 'D', 'R', 'E', 'C', '1' };
+
+const char INDEX_MAGIC[8] = { 'R', 'G', 'B', 'D', 'I', 'D', 'X', '1' };
+
+const uint32_t CHUNK_MAGIC = 0x4b4e4843;  // "CHNK"
+
+struct RecordHeader {
+    char magic[8];
+
+    uint32_t version;
+
+    uint32_t reserved[13];
+};
+
+struct ChunkHeader {
+    uint32_t magic;
+
+    /**
+     * Recorder::Stream of the frame.
+     */
+    uint32_t stream;
+
+    int32_t rows;
+
+    int32_t cols;
+
+    /**
+     * OpenCV type of the pixels.
+     */
+    int32_t type;
+
+    uint32_t reserved;
+
+    uint64_t deviceTime;
+
+    uint64_t hostTime;
+
+    uint64_t sequence;
+
+    uint64_t dropped;
+
+    /**
+     * Size of the pixels padded to RECORD_ALIGNMENT.
+     */
+    uint64_t size;
+};
+
+struct RecordFooter {
+    uint64_t index;
+
+    uint64_t count;
+
+    char magic[8];
+};
+
+}
+
+/**
+ * Recorder of the frames of a camera into a single file, which ReplayCamera
+ * plays back. Point clouds are recorded as organized CV_32FC3 images of x,
+ * y and z, and colored ones as CV_32FC4 images with the packed rgb of PCL.
+ */
+class Recorder {
+public:
+    enum Stream {
+        COLOR,
+        DEPTH,
+        AMPLITUDE,
+        POINT_CLOUD,
+        COLORED_POINT_CLOUD,
+        STREAM_COUNT
+    };
+
+    /**
+     * @param camera Camera to record, which must be a DepthCamera unless
+     *               only the color is recorded
+     * @param file Recording file, which is overwritten
+     * @param streams Bitwise OR of 1 << Stream of the recorded streams
+     */
+    Recorder(std::shared_ptr<ColorCamera> camera, const std::string& file,
+             int streams = 1 << COLOR | 1 << DEPTH);
+
+    /**
+     * Stop recording and close the recording.
+     */
+    virtual ~Recorder();
+
+    /**
+     * Record in a thread of its own, which waits for the frames of the
+     * camera alongside any other consumer of it.
+     */
+    void start();
+
+    /**
+     * Stop the thread started by start().
+     */
+    void stop();
+
+    /**
+     * Record the latest frames of the streams which have not been recorded
+     * yet. This is the way to record while the camera is consumed, called
+     * after each waitForNextFrame().
+     */
+    void record();
+
+    /**
+     * Return the number of frames recorded so far.
+     *
+     * @return Number of frames
+     */
+    uint64_t recorded() const;
+
+private:
+    std::shared_ptr<ColorCamera> _camera;
+
+    std::shared_ptr<DepthCamera> _depth;
+
+    int _streams;
+
+    std::ofstream _out;
+
+    std::vector<uint64_t> _index;
+
+    /**
+     * Host time and sequence number of the last frame recorded per stream.
+     */
+    uint64_t _last[STREAM_COUNT][2];
+
+    PointCloud::Ptr _cloud;
+
+    ColoredPointCloud::Ptr _colored;
+
+    cv::Mat _points;
+
+    volatile bool _running;
+
+    boost::thread _thread;
+
+    mutable boost::mutex _mutex;
+
+    void update();
+
+    void write(Stream stream, const cv::Mat& data, const FrameInfo& info);
+
+    void writeFrame(Stream stream, const Frame::Ptr& frame);
+
+    void close();
+};
+
+}
@@ -0,0 +1,149 @@
+/**
+ * @file ReplayCamera.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <boost/thread.hpp>
+#include "DepthCamera.h"
+#include "Recorder.h"
+
+namespace rgbd {
+
+/**
+ * Camera playing back a recording made by Recorder. The recording is mapped
+ * into memory and its frames are handed out in place without copying, with
+ * the timing information they were recorded with.
+ *
+ * At a positive speed, a thread of its own publishes the frames at their
+ * recorded intervals divided by the speed. Otherwise the recording is played
+ * as fast as it is consumed: a waitForNextFrame() which has seen the latest
+ * frame publishes the frames up to the next one of the main stream, which is
+ * depth if recorded and color otherwise, so that every frame is seen in the
+ * same order on every run.
+ */
+class ReplayCamera: public DepthCamera {
+public:
+    /**
+     * @param file Recording file
+     * @param speed Playback speed relative to the recording, or 0 to play
+     *              as fast as the frames are consumed
+     * @param loop true to start over at the end of the recording
+     */
+    ReplayCamera(const std::string& file, double speed = 1.0, bool loop = false);
+
+    virtual ~ReplayCamera();
+
+    virtual cv::Size colorSize() const;
+
+    virtual cv::Size depthSize() const;
+
+    virtual void start();
+
+    /**
+     * Wait for the next frame of the main stream.
+     *
+     * @param sequence Number of the frame of the main stream the consumer
+     *                 has seen last, or 0 at first
+     * @param timeout Timeout in milliseconds
+     * @return true if a new frame is available, false on timeout or at the
+     *         end of the recording
+     */
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
+    virtual void captureColor(cv::Mat& buffer);
+
+    virtual Frame::Ptr acquireColorFrame();
+
+    virtual void captureDepth(cv::Mat& buffer);
+
+    virtual Frame::Ptr acquireDepthFrame();
+
+    virtual void captureAmplitude(cv::Mat& buffer);
+
+    virtual Frame::Ptr acquireAmplitudeFrame();
+
+    virtual void capturePointCloud(PointCloud::Ptr buffer);
+
+    virtual void captureColoredPointCloud(ColoredPointCloud::Ptr buffer);
+
+    /**
+     * Return whether the stream is recorded.
+     *
+     * @param stream Stream
+     * @return true if the recording has frames of the stream
+     */
+    bool hasStream(Recorder::Stream stream) const;
+
+    /**
+     * Return the number of frames in the recording.
+     *
+     * @return Number of frames of all the streams
+     */
+    size_t frameCount() const;
+
+    /**
+     * Return whether the whole recording has been published.
+     *
+     * @return true at the end of a recording which does not loop
+     */
+    bool finished() const;
+
+private:
+    class Mapping;
+
+    std::shared_ptr<Mapping> _mapping;
+
+    /**
+     * Frames in the order of the recording and their streams.
+     */
+    std::vector<Frame::Ptr> _frames;
+
+    std::vector<int> _streams;
+
+    /**
+     * First frame of each stream, or an empty pointer if not recorded.
+     */
+    Frame::Ptr _first[Recorder::STREAM_COUNT];
+
+    Frame::Ptr _latest[Recorder::STREAM_COUNT];
+
+    int _main;
+
+    double _speed;
+
+    bool _loop;
+
+    size_t _cursor;
+
+    uint64_t _published;
+
+    volatile bool _running;
+
+    boost::thread _thread;
+
+    mutable boost::mutex _mutex;
+
+    boost::condition_variable _condition;
+
+    void index(const std::string& file);
+
+    void update();
+
+    /**
+     * Publish the frame at the cursor and move the cursor on.
+     * The mutex must be locked.
+     *
+     * @return false at the end of the recording
+     */
+    bool publish();
+
+    Frame::Ptr latest(Recorder::Stream stream, const std::string& function);
+};
+
+}
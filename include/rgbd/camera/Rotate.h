@@ -0,0 +1,25 @@
+/**
+ * @file Rotate.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <opencv2/core/core.hpp>
+
+namespace rgbd {
+
+/**
+ * Rotate an image by a multiple of 90 degrees in a single cache-blocked
+ * pass. 90 rotates counterclockwise and -90 clockwise, which is the result
+ * of cv::transpose followed by cv::flip around the x and y axes respectively.
+ *
+ * @param src Source image
+ * @param dst Returned rotated image, reallocated only if its size or type
+ *            differs
+ * @param angle -90, 0, 90, 180 or -180
+ */
+void rotateImage(const cv::Mat& src, cv::Mat& dst, int angle);
+
+}
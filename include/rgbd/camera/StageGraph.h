@@ -0,0 +1,219 @@
+/**
+ * @file StageGraph.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <boost/thread.hpp>
+#include "DepthCamera.h"
+
+namespace rgbd {
+
+/**
+ * Processing step of a StageGraph, which turns named input frames into
+ * named output frames. A stage is run by one thread at a time, but stages
+ * which do not depend on each other run in parallel.
+ */
+class Stage {
+public:
+    typedef std::shared_ptr<Stage> Ptr;
+
+    /**
+     * @param inputs Names of the input frames
+     * @param outputs Names of the output frames
+     */
+    Stage(const std::vector<std::string>& inputs, const std::vector<std::string>& outputs);
+
+    virtual ~Stage();
+
+    const std::vector<std::string>& inputs() const;
+
+    const std::vector<std::string>& outputs() const;
+
+    /**
+     * Process the frames of one capture. The stage is not run unless every
+     * input is available.
+     *
+     * @param inputs Input frames in the order of inputs()
+     * @param outputs Returned output frames in the order of outputs(),
+     *                which may be left empty
+     */
+    virtual void process(const std::vector<Frame::Ptr>& inputs,
+                         std::vector<Frame::Ptr>& outputs) = 0;
+
+protected:
+    /**
+     * Return a recycled frame for an output, carrying the timing
+     * information of the frame it is made from.
+     *
+     * @param output Index of the output
+     * @param source Frame the output is made from
+     * @param size Size of the frame
+     * @param type OpenCV type of the frame
+     * @return Writable frame
+     */
+    std::shared_ptr<Frame> allocate(size_t output, const Frame::Ptr& source,
+                                    const cv::Size& size, int type);
+
+private:
+    std::vector<std::string> _inputs;
+
+    std::vector<std::string> _outputs;
+
+    std::vector<std::shared_ptr<FramePool>> _pools;
+};
+
+/**
+ * Graph of stages fed by the frames of a camera. Each frame of the camera
+ * is acquired once, without copying, and passed through every stage once,
+ * however many outputs are read and by however many consumers.
+ *
+ * The frames of the camera are named "color", and "depth" and "amplitude"
+ * for a depth camera. Only those read by a stage or a consumer are
+ * acquired. Point clouds are passed between stages as organized frames of
+ * CV_32FC3, which toPointCloud() converts.
+ */
+class StageGraph {
+public:
+    typedef std::function<void(const Frame::Ptr&)> Callback;
+
+    StageGraph(std::shared_ptr<ColorCamera> camera);
+
+    virtual ~StageGraph();
+
+    /**
+     * Add a stage. Stages must be added before the first frame is processed.
+     *
+     * @param stage Stage reading frames of the camera or of other stages
+     */
+    void add(Stage::Ptr stage);
+
+    /**
+     * Call the callback with each new frame of the name, from the thread
+     * processing the frames.
+     *
+     * @param name Name of a frame
+     * @param callback Callback, which must return quickly
+     */
+    void subscribe(const std::string& name, Callback callback);
+
+    /**
+     * Process the frames in a thread of its own, which waits for the frames
+     * of the camera.
+     */
+    void start();
+
+    void stop();
+
+    /**
+     * Acquire the latest frames of the camera and process them, unless
+     * they have been processed already. This is for callers driving the
+     * graph from a thread of their own instead of start(), and must not be
+     * called while the graph is running, since the thread of start() calls
+     * it as well.
+     *
+     * @return false if the camera has no new frame
+     */
+    bool process();
+
+    /**
+     * Return the latest frame of the name.
+     *
+     * @param name Name of a frame
+     * @return Frame, or an empty pointer if none has been processed
+     */
+    Frame::Ptr latest(const std::string& name) const;
+
+    /**
+     * Block until frames newer than the ones the consumer has seen are
+     * processed. Each consumer keeps its own sequence.
+     *
+     * @param sequence Number of the processing the consumer has seen last,
+     *                 or 0 at first. Set to the latest one if new frames are
+     *                 available.
+     * @param timeout Timeout in milliseconds
+     * @return true if new frames are available, false on timeout
+     */
+    bool waitForNext(uint64_t& sequence, int timeout);
+
+    /**
+     * Copy a frame of CV_32FC3 into an organized point cloud.
+     *
+     * @param frame Frame of points
+     * @param buffer Returned point cloud
+     */
+    static void toPointCloud(const Frame::Ptr& frame, PointCloud::Ptr buffer);
+
+private:
+    class Runner;
+
+    std::shared_ptr<ColorCamera> _camera;
+
+    std::shared_ptr<DepthCamera> _depth;
+
+    std::vector<Stage::Ptr> _stages;
+
+    std::multimap<std::string, Callback> _callbacks;
+
+    /**
+     * Index of each name into the frames of a capture.
+     */
+    std::map<std::string, size_t> _slots;
+
+    /**
+     * Stages grouped into levels, each of which only depends on the levels
+     * before it.
+     */
+    std::vector<std::vector<size_t>> _levels;
+
+    std::vector<std::vector<size_t>> _inputSlots;
+
+    std::vector<std::vector<size_t>> _outputSlots;
+
+    /**
+     * Arguments of the stages, kept so that running a stage allocates
+     * nothing.
+     */
+    std::vector<std::vector<Frame::Ptr>> _inputs;
+
+    std::vector<std::vector<Frame::Ptr>> _outputs;
+
+    /**
+     * Time and sequence number of the last frame processed of the stream
+     * which drives the graph.
+     */
+    uint64_t _last[2];
+
+    bool _scheduled;
+
+    std::vector<Frame::Ptr> _frames;
+
+    std::vector<Frame::Ptr> _latest;
+
+    uint64_t _processed;
+
+    volatile bool _running;
+
+    boost::thread _thread;
+
+    mutable boost::mutex _mutex;
+
+    boost::condition_variable _condition;
+
+    void schedule();
+
+    size_t slot(const std::string& name);
+
+    void runStage(size_t index);
+
+    void update();
+};
+
+}
@@ -0,0 +1,148 @@
+/**
+ * @file Stages.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include "StageGraph.h"
+#include "Undistorter.h"
+#include "DepthRegistrator.h"
+
+namespace rgbd {
+
+/**
+ * Rotation by a multiple of 90 degrees, as ColorRotator and DepthRotator.
+ */
+class RotateStage: public Stage {
+public:
+    /**
+     * @param input Name of the input frame
+     * @param output Name of the rotated frame
+     * @param angle -90, 0, 90, 180 or -180, or UnsupportedException is
+     *              thrown
+     */
+    RotateStage(const std::string& input, const std::string& output, int angle);
+
+    virtual ~RotateStage();
+
+    virtual void process(const std::vector<Frame::Ptr>& inputs, std::vector<Frame::Ptr>& outputs);
+
+private:
+    int _angle;
+};
+
+/**
+ * Lens undistortion, as DistortionCalibrator.
+ */
+class UndistortStage: public Stage {
+public:
+    /**
+     * @param input Name of the input frame
+     * @param output Name of the undistorted frame
+     * @param intrinsics Intrinsics file readable by Undistorter
+     * @param size Size of the input frame
+     */
+    UndistortStage(const std::string& input, const std::string& output,
+                   const std::string& intrinsics, const cv::Size& size);
+
+    virtual ~UndistortStage();
+
+    virtual void process(const std::vector<Frame::Ptr>& inputs, std::vector<Frame::Ptr>& outputs);
+
+private:
+    Undistorter _undistorter;
+};
+
+/**
+ * White balance of color, as ColorCalibrator.
+ */
+class WhiteBalanceStage: public Stage {
+public:
+    /**
+     * @param input Name of the input frame of CV_8UC3
+     * @param output Name of the balanced frame
+     */
+    WhiteBalanceStage(const std::string& input, const std::string& output);
+
+    virtual ~WhiteBalanceStage();
+
+    /**
+     * Estimate the white balance from an image of a gray target.
+     *
+     * @param gray Image of CV_8UC3
+     */
+    void setGrayImage(const cv::Mat& gray);
+
+    virtual void process(const std::vector<Frame::Ptr>& inputs, std::vector<Frame::Ptr>& outputs);
+
+private:
+    cv::Mat _lut;
+};
+
+/**
+ * Registration of depth to the color image by a DepthRegistrator.
+ */
+class RegisterStage: public Stage {
+public:
+    /**
+     * @param registrator Registrator of the camera feeding the graph
+     * @param input Name of the raw depth frame
+     * @param output Name of the registered depth frame
+     */
+    RegisterStage(std::shared_ptr<DepthRegistrator> registrator,
+                  const std::string& input = "depth", const std::string& output = "registered");
+
+    virtual ~RegisterStage();
+
+    virtual void process(const std::vector<Frame::Ptr>& inputs, std::vector<Frame::Ptr>& outputs);
+
+private:
+    std::shared_ptr<DepthRegistrator> _registrator;
+};
+
+/**
+ * Organized point cloud of depth, in meters in the camera coordinates.
+ * Pixels without depth are NaN.
+ */
+class PointCloudStage: public Stage {
+public:
+    /**
+     * @param input Name of the depth frame of CV_16U or CV_32F
+     * @param output Name of the point cloud frame of CV_32FC3
+     * @param cameraMatrix Camera matrix of the depth frame
+     * @param distCoeffs Distortion coefficients of the depth frame
+     * @param size Size of the depth frame, which every depth frame must
+     *             have, or the process exits
+     * @param depthUnit Length of a depth value in meters
+     * @param maxDepth Largest valid depth value. Larger values are NaN,
+     *                 such as the saturated and low confidence codes 32001
+     *                 and 32002 of DS325 by default.
+     */
+    PointCloudStage(const std::string& input, const std::string& output,
+                    const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs,
+                    const cv::Size& size, float depthUnit = 0.001f,
+                    float maxDepth = 32000.0f);
+
+    virtual ~PointCloudStage();
+
+    virtual void process(const std::vector<Frame::Ptr>& inputs, std::vector<Frame::Ptr>& outputs);
+
+private:
+    float _depthUnit;
+
+    /**
+     * Largest valid depth in meters.
+     */
+    float _maxDepth;
+
+    /**
+     * Normalized undistorted coordinates of the pixels.
+     */
+    cv::Mat _rays;
+
+    cv::Mat _meters;
+};
+
+}
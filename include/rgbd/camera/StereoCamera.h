@@ -7,8 +7,11 @@
 #pragma once
 
 #include <memory>
+#include <atomic>
+#include <boost/thread.hpp>
 #include <opencv2/calib3d/calib3d.hpp>
 #include "rgbd/camera/DepthCamera.h"
+#include "rgbd/camera/DisparityEngine.h"
 
 namespace rgbd {
 
@@ -29,6 +32,73 @@ public:
 
     virtual void start();
 
+    /**
+     * Block until both cameras have a new frame within the timeout.
+     *
+     * @param sequence Sequence number of the left frame the consumer has
+     *                 seen last, or 0 at first
+     * @param timeout Timeout in milliseconds
+     * @return true if a new pair is available, false on timeout
+     */
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
+    /**
+     * Replace the disparity engine, which is SGBM by default.
+     *
+     * @param engine Disparity engine
+     */
+    void setDisparityEngine(DisparityEngine::Ptr engine);
+
+    /**
+     * Synchronize the exposures of the left and right cameras.
+     * SOFTWARE_TRIGGER triggers both cameras together for every pair.
+     * HARDWARE_TRIGGER lets the left camera run freely and expects its flash
+     * output to be wired to the trigger input of the right one.
+     * FREE_RUN, the default, leaves both cameras unsynchronized.
+     *
+     * @param mode Synchronization mode
+     * @param maxSkew Maximum time difference of a pair in microseconds
+     */
+    void setSynchronization(TriggerMode mode, uint64_t maxSkew = 5000);
+
+    /**
+     * Capture a rectified pair of left and right images exposed together.
+     * Pairs whose timestamps differ by more than the maximum skew are
+     * dropped and captured again, except in FREE_RUN mode which returns
+     * the latest images as they are.
+     *
+     * Pairs are acquired only by a thread of the camera, which acquires and
+     * rectifies the next pair from frames newer than this one while the
+     * caller works on this one, e.g. while captureColoredPointCloud()
+     * computes its disparity. The next pair is dropped and acquired again if
+     * the caller comes back more than twice as late as for the previous
+     * pair, so a pair is never stale after the caller has been idle. In
+     * FREE_RUN the latest frames are returned again if a camera has no new
+     * frame within the timeout.
+     *
+     * @param left Returned left matrix of CV_8UC3
+     * @param right Returned right matrix of CV_8UC3
+     * @param timeout Timeout in milliseconds
+     * @return true if a matched pair has been captured
+     */
+    bool captureStereoPair(cv::Mat& left, cv::Mat& right, int timeout = 1000);
+
+    /**
+     * Return the time difference of the last captured pair.
+     *
+     * @return Left minus right host time in microseconds
+     */
+    int64_t lastSkew() const;
+
+    /**
+     * Select the layout of captured point clouds. Organized clouds keep the
+     * image layout and mark pixels without depth with NaN, the others
+     * contain valid points only, which is the default.
+     *
+     * @param organized true to capture organized point clouds
+     */
+    void setOrganized(bool organized);
+
     void captureColor(cv::Mat& buffer);
 
     virtual void captureColorL(cv::Mat& buffer);
@@ -37,6 +107,13 @@ public:
 
     virtual void capturePointCloud(PointCloud::Ptr buffer);
 
+    /**
+     * Capture the colored point cloud of the pair returned by the last
+     * captureStereoPair(), so that the cloud matches the images shown with
+     * it, or of a new pair if that one has been used for a cloud already.
+     *
+     * @param buffer Returned point cloud
+     */
     virtual void captureColoredPointCloud(ColoredPointCloud::Ptr buffer);
 
 protected:
@@ -44,18 +121,84 @@ protected:
 
     cv::Mat _lcolor, _rcolor;
 
-    cv::StereoSGBM _sgbm;
+    DisparityEngine::Ptr _engine;
+
+    TriggerMode _sync;
+
+    uint64_t _maxSkew;
 
-    void setUpStereoParams();
+    std::atomic<int64_t> _skew;
 
 private:
     cv::Mat _map11, _map12, _map21, _map22;
 
     cv::Mat _Q;
 
+    bool _organized;
+
+    cv::Mat _disparity;
+
+    std::vector<int> _counts;
+
+    /**
+     * Sequence numbers of the frames of the cameras seen last by the pairs.
+     */
+    uint64_t _lsequence, _rsequence;
+
+    /**
+     * Current pair returned by captureStereoPair() and the next pair, which
+     * is written by the acquisition thread.
+     */
+    cv::Mat _lpair, _rpair, _lnext, _rnext;
+
+    /**
+     * true until the current pair is used for a point cloud.
+     */
+    bool _unused;
+
+    boost::thread _acquirer;
+
+    boost::mutex _pairMutex;
+
+    boost::condition_variable _pairCondition;
+
+    /**
+     * State of the acquisition thread, guarded by the pair mutex.
+     */
+    bool _running, _requested, _prefetched, _acquired;
+
+    int _timeout;
+
+    int64_t _nextSkew;
+
+    /**
+     * Host time the current pair was returned, and the time the caller took
+     * for the previous pair in microseconds.
+     */
+    uint64_t _pairTime, _period;
+
     void loadCameraParams(const std::string& intrinsics, const std::string& extrinsics);
 
-    cv::Mat reprojectImage();
+    bool acquireStereoPair(Frame::Ptr& lframe, Frame::Ptr& rframe, int64_t& skew, int timeout);
+
+    void rectifyStereoPair(const Frame::Ptr& lframe, const Frame::Ptr& rframe,
+                           cv::Mat& left, cv::Mat& right);
+
+    /**
+     * Make the next pair the current one and request the one after it.
+     *
+     * @param timeout Timeout in milliseconds
+     * @return true if a pair has been acquired
+     */
+    bool nextPair(int timeout);
+
+    void acquire();
+
+    cv::Mat computeDisparity(const cv::Mat& left, const cv::Mat& right);
+
+    template <typename PointT>
+    void projectDisparity(const cv::Mat& disparity, const cv::Mat& color,
+                          pcl::PointCloud<PointT>& cloud);
 };
 
 }
@@ -0,0 +1,110 @@
+/**
+ * @file SyntheticDepthCamera.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include "DepthCamera.h"
+
+namespace rgbd {
+
+/**
+ * Depth camera rendering a moving sphere in front of a tilted checkered
+ * wall instead of talking to a device. A thread of its own renders and
+ * publishes the frames at a fixed rate, in the same way as the device
+ * threads of the real cameras, and counts the frames it is too slow for
+ * as dropped.
+ *
+ * The color camera shares the viewpoint and the horizontal field of view of
+ * the depth camera, so the images of both are aligned horizontally, but
+ * 16:9 color sees fewer rows than 4:3 depth. Colored point clouds take the
+ * color of each point where its ray is seen by the color camera.
+ */
+class SyntheticDepthCamera: public DepthCamera {
+public:
+    /**
+     * Geometry of a real camera.
+     */
+    enum Model {
+        /**
+         * 320x240 depth and amplitude of CV_16U in millimeters, and
+         * 1280x720 color.
+         */
+        DS325_MODEL,
+
+        /**
+         * 160x120 depth and amplitude of CV_32F in meters, without color.
+         */
+        PMD_NANO_MODEL
+    };
+
+    /**
+     * @param model Geometry of a real camera
+     * @param fps Frame rate
+     */
+    SyntheticDepthCamera(Model model, double fps = 30.0);
+
+    /**
+     * @param depthSize Size of depth image
+     * @param colorSize Size of color image, or an empty size without color
+     * @param depthType CV_16U for depth in millimeters or CV_32F in meters
+     * @param fps Frame rate
+     */
+    SyntheticDepthCamera(const cv::Size& depthSize, const cv::Size& colorSize, int depthType,
+                         double fps = 30.0);
+
+    virtual ~SyntheticDepthCamera();
+
+    virtual cv::Size colorSize() const;
+
+    virtual cv::Size depthSize() const;
+
+    virtual void start();
+
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
+    virtual void captureColor(cv::Mat& buffer);
+
+    virtual Frame::Ptr acquireColorFrame();
+
+    virtual void captureDepth(cv::Mat& buffer);
+
+    virtual Frame::Ptr acquireDepthFrame();
+
+    virtual void captureAmplitude(cv::Mat& buffer);
+
+    virtual Frame::Ptr acquireAmplitudeFrame();
+
+    virtual void capturePointCloud(PointCloud::Ptr buffer);
+
+    virtual void captureColoredPointCloud(ColoredPointCloud::Ptr buffer);
+
+private:
+    cv::Size _dsize;
+
+    cv::Size _csize;
+
+    int _depthType;
+
+    uint64_t _period;
+
+    volatile bool _running;
+
+    boost::thread _thread;
+
+    FramePool _dframes;
+
+    FramePool _aframes;
+
+    FramePool _vframes;
+
+    FramePool _cframes;
+
+    void update();
+};
+
+}
@@ -12,13 +12,29 @@
 #include <uEye.h>
 #include "ueye_cam_driver.hpp"
 #include "ColorCamera.h"
+#include "Metrics.h"
 
 namespace rgbd {
 
+/**
+ * uEye camera captured in ring buffer mode. Frames returned by
+ * acquireColorFrame() point directly into the locked image memories of
+ * the driver, so a frame held by a consumer is never overwritten, but it
+ * keeps one memory of the ring out of use until it is released. Frames
+ * keep their memory valid even if the ring buffer is reallocated, and keep
+ * the driver, so they may outlive the camera. The frames wrapping the
+ * memories are recycled, so capturing allocates nothing once warmed up.
+ */
 class UEye: public ColorCamera {
 public:
+    /**
+     * @param deviceNo Device number
+     * @param file Camera configuration file
+     * @param name Camera name
+     * @param buffers Number of image memories in the ring buffer
+     */
     UEye(const uint deviceNo, const std::string& file,
-         const std::string& name = "uEye");
+         const std::string& name = "uEye", const uint buffers = 4);
 
     virtual ~UEye();
 
@@ -28,16 +44,49 @@ public:
 
     virtual void start();
 
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
+    /**
+     * HARDWARE_TRIGGER captures on a falling edge at the digital input.
+     * In FREE_RUN the flash output is driven high during exposure, so it can
+     * trigger other cameras in HARDWARE_TRIGGER mode.
+     */
+    virtual void setTriggerMode(TriggerMode mode);
+
+    virtual void trigger();
+
     virtual void captureColor(cv::Mat& buffer);
 
+    virtual Frame::Ptr acquireColorFrame();
+
 private:
+    class Recycler;
+
     HIDS _deviceNo;
 
     std::shared_ptr<ueye_cam::UEyeCamDriver> _driver;
 
+    std::shared_ptr<Recycler> _recycler;
+
     cv::Size _size;
 
-    boost::mutex _mutex;
+    TriggerMode _mode;
+
+    volatile bool _running;
+
+    boost::thread _thread;
+
+    FramePool _frames;
+
+    uint64_t _frameNumber;
+
+    uint64_t _dropped;
+
+    Counter* _deviceDropped;
+
+    void applyTriggerMode();
+
+    void update();
 };
 
 }
@@ -28,8 +28,12 @@ public:
 
     virtual void start();
 
+    virtual bool waitForNextFrame(uint64_t& sequence, int timeout);
+
     virtual void captureColor(cv::Mat& buffer);
 
+    virtual Frame::Ptr acquireColorFrame();
+
 private:
     cv::VideoCapture _capture;
 
@@ -37,9 +41,7 @@ private:
 
     const long _usleep;
 
-    cv::Mat _buffer;
-
-    boost::mutex _mutex;
+    FramePool _frames;
 
     void update();
 };
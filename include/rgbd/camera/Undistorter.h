@@ -0,0 +1,57 @@
+/**
+ * @file Undistorter.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace rgbd {
+
+/**
+ * Lens undistortion by fixed-point bilinear remapping, split into row bands
+ * processed in parallel.
+ */
+class Undistorter {
+public:
+    Undistorter();
+
+    virtual ~Undistorter();
+
+    /**
+     * Build the undistortion maps from an intrinsics file holding either
+     * M and D, or cameraMatrix and distCoeffs.
+     * The maps are cached next to the intrinsics file, with the extension
+     * ".map", and reused while the intrinsics file and the size are unchanged.
+     *
+     * @param intrinsics Intrinsics file
+     * @param size Size of images
+     * @param cache false to always build the maps
+     * @return true if the maps are ready
+     */
+    bool load(const std::string& intrinsics, const cv::Size& size, bool cache = true);
+
+    /**
+     * Undistort the image. The source and destination must not be the same,
+     * which would force OpenCV to copy the source first.
+     *
+     * @param src Distorted image
+     * @param dst Returned undistorted image, reallocated only if its size or
+     *            type differs
+     */
+    void undistort(const cv::Mat& src, cv::Mat& dst) const;
+
+private:
+    cv::Mat _maps[2];
+
+    bool loadCache(const std::string& file, uint64_t hash, const cv::Size& size);
+
+    void saveCache(const std::string& file, uint64_t hash) const;
+};
+
+}
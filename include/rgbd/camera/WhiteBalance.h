@@ -0,0 +1,34 @@
+/**
+ * @file WhiteBalance.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <opencv2/core/core.hpp>
+
+namespace rgbd {
+
+/**
+ * Estimate the white balance from an image of a gray target as the ratios
+ * of the channel sums, which ignores black pixels instead of dividing by
+ * them.
+ *
+ * @param gray Image of CV_8UC3, or an empty image for no correction
+ * @param rscale Returned gain of red
+ * @param bscale Returned gain of blue
+ */
+void estimateWhiteBalance(const cv::Mat& gray, double& rscale, double& bscale);
+
+/**
+ * Build the per-channel lookup table of a white balance, so that a frame
+ * is corrected by cv::LUT in a single pass.
+ *
+ * @param rscale Gain of red
+ * @param bscale Gain of blue
+ * @param lut Returned 1x256 matrix of CV_8UC3
+ */
+void buildWhiteBalanceLUT(double rscale, double bscale, cv::Mat& lut);
+
+}
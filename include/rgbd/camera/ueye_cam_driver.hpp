@@ -51,7 +51,10 @@
 #include <string.h>
 #include <uEye.h>
 #include <string>
+#include <vector>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
@@ -81,8 +84,11 @@ class UEyeCamDriver {
 public:
     /**
      * Initializes member variables.
+     *
+     * \param buffer_count Number of image memories in the capture ring buffer.
      */
-    UEyeCamDriver(int cam_ID = 0, std::string cam_name = "camera");
+    UEyeCamDriver(int cam_ID = 0, std::string cam_name = "camera",
+                  unsigned int buffer_count = 4);
 
     /**
      * Terminates UEye camera interface.
@@ -99,7 +105,9 @@ public:
     virtual INT connectCam(int new_cam_ID = -1);
 
     /**
-     * Terminates and releases the UEye camera handle.
+     * Terminates and releases the UEye camera handle. Blocks until every image
+     * memory locked by lockNextFrame() has been returned with unlockFrame(),
+     * since releasing the handle frees the memories.
      *
      * \return IS_SUCCESS if successful, error flag otherwise (see err2str).
      */
@@ -307,6 +315,26 @@ public:
      */
     INT setExtTriggerMode();
 
+    /**
+     * Sets current camera to software trigger mode, where a frame is captured
+     * each time triggerFrame() is called. Triggering several cameras one after
+     * another exposes them within the latency of the trigger calls.
+     *
+     * Note that this function only sets the mode. Frames are then grabbed by
+     * calling processNextFrame() or lockNextFrame().
+     *
+     * \return IS_SUCCESS if successful, error flag otherwise (see err2str).
+     */
+    INT setSoftTriggerMode();
+
+    /**
+     * Triggers a single capture in software trigger mode without waiting for
+     * the frame to arrive.
+     *
+     * \return IS_SUCCESS if successful, error flag otherwise (see err2str).
+     */
+    INT triggerFrame();
+
     /**
      * Disables either free-run or external trigger mode, and sets the current
      * camera to standby mode.
@@ -323,12 +351,44 @@ public:
      * at the maximum rate possible given current camera settings.
      *
      * \param timeout_ms Timeout duration while waiting for next frame event.
+     * \param info If not NULL, filled with the image information of the frame,
+     *   such as its device timestamp and frame number.
      *
      * \return Pointer to raw image buffer if successful, NULL otherwise.
      *         WARNING: image buffer contents may change during capture, or may become
      *         invalid after calling other functions!
      */
-    const char* processNextFrame(INT timeout_ms);
+    const char* processNextFrame(INT timeout_ms, UEYEIMAGEINFO* info = NULL);
+
+    /**
+     * Waits for next frame to be available, then locks the image memory holding
+     * it, so that the camera keeps filling the other memories of the ring buffer
+     * and never overwrites the frame while it is being read.
+     *
+     * \param timeout_ms Timeout duration while waiting for next frame event.
+     * \param info If not NULL, filled with the image information of the frame.
+     *
+     * \return Pointer to locked image memory if successful, NULL otherwise.
+     *         The memory must be returned with unlockFrame(). It stays valid
+     *         until then, even if the ring buffer is reallocated meanwhile.
+     */
+    char* lockNextFrame(INT timeout_ms, UEYEIMAGEINFO* info = NULL);
+
+    /**
+     * Returns an image memory locked by lockNextFrame() to the ring buffer,
+     * or frees it if the ring buffer has been reallocated since it was locked.
+     * May be called from any thread.
+     *
+     * \return IS_SUCCESS if successful, error flag otherwise (see err2str).
+     */
+    INT unlockFrame(char* buffer);
+
+    /**
+     * Returns the pitch (a.k.a. stride) of the image memories in bytes.
+     */
+    inline INT getBufferPitch() const {
+        return cam_buffer_pitch_;
+    }
 
     inline bool isConnected() {
         return (cam_handle_ != (HIDS) 0);
@@ -346,6 +406,11 @@ public:
                 (is_CaptureVideo(cam_handle_, IS_GET_LIVE) == TRUE));
     }
 
+    inline bool softTriggerModeActive() {
+        return ((cam_handle_ != (HIDS) 0) &&
+                (is_SetExternalTrigger(cam_handle_, IS_GET_EXTERNALTRIGGER) == IS_SET_TRIGGER_SOFTWARE));
+    }
+
     inline bool isCapturing() {
         return ((cam_handle_ != (HIDS) 0) &&
                 (is_CaptureVideo(cam_handle_, IS_GET_LIVE) == TRUE));
@@ -359,14 +424,32 @@ public:
     const static char* err2str(INT error);
 
 protected:
-    static int CAMERA_BUFFER_ID;
-
     INT reallocateCamBuffer();
 
+    /**
+     * Frees the image memories of the ring buffer, except the locked ones
+     * which are freed by unlockFrame() once they are returned.
+     */
+    void freeCamBuffer();
+
+    /**
+     * Waits for next frame and returns the image memory it was written to.
+     */
+    char* waitForNextBuffer(INT timeout_ms, UEYEIMAGEINFO* info);
+
     HIDS cam_handle_;
     SENSORINFO cam_sensor_info_;
-    char* cam_buffer_;
-    int cam_buffer_id_;
+    std::vector<char*> cam_buffers_;
+    std::vector<int> cam_buffer_ids_;
+    /**
+     * Image memories locked by lockNextFrame(), and the memories with their
+     * ids which have been removed from the ring buffer while locked.
+     */
+    std::vector<char*> locked_buffers_;
+    std::vector<std::pair<char*, int>> retired_buffers_;
+    std::mutex buffer_mutex_;
+    std::condition_variable buffer_unlocked_;
+    unsigned int cam_buffer_count_;
     INT cam_buffer_pitch_;
     unsigned int cam_buffer_size_;
     std::string cam_name_;
@@ -0,0 +1,84 @@
+/**
+ * @file TripleBuffer.h
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <atomic>
+
+namespace rgbd {
+
+/**
+ * Lock-free single-producer single-consumer triple buffer.
+ * The producer writes back() and calls publish(), the consumer calls
+ * update() and reads front(). Neither side ever waits for the other,
+ * and the consumer always sees the latest complete value.
+ *
+ * Several consumer threads must serialize update() and front() among
+ * themselves, which still never blocks the producer.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() :
+            _middle(1),
+            _back(0),
+            _front(2) {
+    }
+
+    /**
+     * Return the buffer the producer writes to.
+     *
+     * @return Back buffer
+     */
+    T& back() {
+        return _buffers[_back];
+    }
+
+    /**
+     * Hand the back buffer over to the consumer.
+     */
+    void publish() {
+        _back = _middle.exchange(_back | DIRTY, std::memory_order_acq_rel) & INDEX;
+    }
+
+    /**
+     * Make the latest published buffer the front one.
+     *
+     * @return true if a buffer newer than the previous front has been published
+     */
+    bool update() {
+        if (!(_middle.load(std::memory_order_relaxed) & DIRTY))
+            return false;
+
+        _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX;
+
+        return true;
+    }
+
+    /**
+     * Return the buffer the consumer reads from.
+     *
+     * @return Front buffer
+     */
+    const T& front() const {
+        return _buffers[_front];
+    }
+
+private:
+    static const int INDEX = 0x3;
+
+    static const int DIRTY = 0x4;
+
+    T _buffers[3];
+
+    std::atomic<int> _middle;
+
+    int _back;
+
+    int _front;
+};
+
+}
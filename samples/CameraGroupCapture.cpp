@@ -0,0 +1,50 @@
+/**
+ * @file CameraGroupCapture.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <memory>
+#include <boost/thread/thread.hpp>
+#include <gflags/gflags.h>
+#include "rgbd/camera/CameraGroup.h"
+#include "rgbd/camera/SyntheticDepthCamera.h"
+
+using namespace rgbd;
+
+DEFINE_int32(cameras, 4, "number of synthetic cameras");
+DEFINE_double(fps, 60.0, "frame rate");
+DEFINE_int32(tolerance, 5000, "maximum skew of a frame set in microseconds");
+DEFINE_bool(pin, true, "pin each acquisition thread to a CPU");
+DEFINE_int32(sets, 600, "number of frame sets to receive");
+
+int main(int argc, char *argv[]) {
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+    const int cpus = std::max(1u, boost::thread::hardware_concurrency());
+    CameraGroup group(FLAGS_tolerance);
+
+    for (int i = 0; i < FLAGS_cameras; i++)
+        group.add(std::shared_ptr<ColorCamera>(
+                new SyntheticDepthCamera(SyntheticDepthCamera::PMD_NANO_MODEL, FLAGS_fps)),
+                  FLAGS_pin ? i % cpus : -1);
+
+    group.start();
+
+    CameraGroup::FrameSet set;
+    uint64_t skew = 0;
+
+    for (int received = 0; received < FLAGS_sets; ) {
+        if (!group.waitForNextSet(set, 1000))
+            continue;
+
+        skew = std::max(skew, set.skew);
+        received++;
+    }
+
+    group.stop();
+    std::cout << "sets " << set.sequence << ", max skew " << skew << " us, dropped "
+              << group.dropped() << " frames" << std::endl;
+
+    return 0;
+}
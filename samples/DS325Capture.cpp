@@ -11,10 +11,12 @@
 #include <pcl/visualization/cloud_viewer.h>
 #include <gflags/gflags.h>
 #include "rgbd/camera/DS325.h"
+#include "rgbd/camera/Recorder.h"
 
 using namespace rgbd;
 
 DEFINE_int32(id, 0, "camera id");
+DEFINE_string(record, "", "recording file");
 
 int main(int argc, char *argv[]) {
     gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -22,6 +24,13 @@ int main(int argc, char *argv[]) {
     std::shared_ptr<DepthCamera> camera(new DS325(FLAGS_id, FRAME_FORMAT_WXGA_H));
     camera->start();
 
+    std::shared_ptr<Recorder> recorder;
+
+    if (!FLAGS_record.empty())
+        recorder.reset(new Recorder(camera, FLAGS_record,
+                                    1 << Recorder::COLOR | 1 << Recorder::DEPTH |
+                                    1 << Recorder::AMPLITUDE));
+
     cv::Mat depth = cv::Mat::zeros(camera->depthSize(), CV_16U);
     cv::Mat amplitude = cv::Mat::zeros(camera->depthSize(), CV_16U);
     cv::Mat color = cv::Mat::zeros(camera->colorSize(), CV_8UC3);
@@ -34,12 +43,20 @@ int main(int argc, char *argv[]) {
     cv::namedWindow("Amplitude", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
     cv::namedWindow("Color", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
 
-    while (cv::waitKey(30) != 0x1b) {
+    uint64_t sequence = 0;
+
+    while (cv::waitKey(1) != 0x1b) {
+        if (!camera->waitForNextFrame(sequence, 1000))
+            continue;
+
         camera->captureDepth(depth);
         camera->captureAmplitude(amplitude);
         camera->captureColor(color);
         camera->captureColoredPointCloud(cloud);
 
+        if (recorder)
+            recorder->record();
+
         cv::Mat d, a;
         depth.convertTo(d, CV_8U, 255.0 / 1000.0);
         amplitude.convertTo(a, CV_8U, 255.0 / 1000.0);
@@ -33,7 +33,12 @@ int main(int argc, char *argv[]) {
     cv::namedWindow("Depth", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
     cv::namedWindow("Amplitude", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
 
-    while (cv::waitKey(10) != 0x1b) {
+    uint64_t sequence = 0;
+
+    while (cv::waitKey(1) != 0x1b) {
+        if (!camera->waitForNextFrame(sequence, 1000))
+            continue;
+
         camera->captureDepth(depth);
         camera->captureAmplitude(amplitude);
         camera->capturePointCloud(cloud);
@@ -0,0 +1,60 @@
+/**
+ * @file ReplayCapture.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <memory>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <gflags/gflags.h>
+#include "rgbd/camera/ReplayCamera.h"
+
+using namespace rgbd;
+
+DEFINE_string(file, "", "recording file");
+DEFINE_double(speed, 1.0, "playback speed, or 0 to play as fast as possible");
+DEFINE_bool(loop, false, "start over at the end of the recording");
+
+int main(int argc, char *argv[]) {
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+    std::shared_ptr<ReplayCamera> camera(new ReplayCamera(FLAGS_file, FLAGS_speed, FLAGS_loop));
+    camera->start();
+
+    if (camera->hasStream(Recorder::COLOR))
+        cv::namedWindow("Color", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
+    if (camera->hasStream(Recorder::DEPTH))
+        cv::namedWindow("Depth", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
+
+    uint64_t sequence = 0;
+
+    while (cv::waitKey(1) != 0x1b) {
+        if (!camera->waitForNextFrame(sequence, 1000)) {
+            if (camera->finished())
+                break;
+
+            continue;
+        }
+
+        if (camera->hasStream(Recorder::COLOR)) {
+            Frame::Ptr color = camera->acquireColorFrame();
+
+            if (color)
+                cv::imshow("Color", color->data);
+        }
+
+        if (camera->hasStream(Recorder::DEPTH)) {
+            Frame::Ptr depth = camera->acquireDepthFrame();
+
+            if (depth) {
+                cv::Mat d;
+                depth->data.convertTo(d, CV_8U, 255.0 / 1000.0);
+                cv::imshow("Depth", d);
+            }
+        }
+    }
+
+    return 0;
+}
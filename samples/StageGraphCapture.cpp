@@ -0,0 +1,61 @@
+/**
+ * @file StageGraphCapture.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <memory>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <gflags/gflags.h>
+#include "rgbd/camera/SyntheticDepthCamera.h"
+#include "rgbd/camera/Stages.h"
+
+using namespace rgbd;
+
+DEFINE_int32(angle, 180, "rotation angle");
+DEFINE_double(fps, 30.0, "frame rate");
+
+int main(int argc, char *argv[]) {
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+    std::shared_ptr<DepthCamera> camera(
+            new SyntheticDepthCamera(SyntheticDepthCamera::DS325_MODEL, FLAGS_fps));
+    StageGraph graph(camera);
+
+    // Color is rotated and balanced, and depth is rotated in parallel with
+    // the color branch. Each frame is acquired once, whoever reads it.
+    graph.add(Stage::Ptr(new RotateStage("color", "rotated", FLAGS_angle)));
+    graph.add(Stage::Ptr(new WhiteBalanceStage("rotated", "balanced")));
+    graph.add(Stage::Ptr(new RotateStage("depth", "rotated_depth", FLAGS_angle)));
+
+    camera->start();
+    graph.start();
+
+    cv::namedWindow("Color", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
+    cv::namedWindow("Depth", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
+
+    uint64_t sequence = 0;
+
+    while (cv::waitKey(1) != 0x1b) {
+        if (!graph.waitForNext(sequence, 1000))
+            continue;
+
+        Frame::Ptr color = graph.latest("balanced");
+        Frame::Ptr depth = graph.latest("rotated_depth");
+
+        if (color)
+            cv::imshow("Color", color->data);
+
+        if (depth) {
+            cv::Mat d;
+            depth->data.convertTo(d, CV_8U, 255.0 / 1500.0);
+            cv::imshow("Depth", d);
+        }
+    }
+
+    graph.stop();
+
+    return 0;
+}
@@ -21,6 +21,9 @@ DEFINE_string(left_conf, "data/ueye-conf.ini", "left camera conf");
 DEFINE_string(right_conf, "data/ueye-conf.ini", "right camera conf");
 DEFINE_string(intrinsics, "intrinsics.xml", "intrinsics file");
 DEFINE_string(extrinsics, "extrinsics.xml", "extrinsics file");
+DEFINE_string(sync, "none", "synchronization: none, software, or hardware");
+DEFINE_int32(max_skew, 5000, "maximum skew of a stereo pair in microseconds");
+DEFINE_string(disparity, "", "disparity engine conf");
 
 int main(int argc, char *argv[]) {
     gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -29,6 +32,21 @@ int main(int argc, char *argv[]) {
     std::shared_ptr<UEye> right(new UEye(FLAGS_right_id, FLAGS_right_conf, "Right"));
     std::shared_ptr<StereoCamera> camera(new StereoCamera(
             left, right, FLAGS_intrinsics, FLAGS_extrinsics));
+
+    if (!FLAGS_disparity.empty()) {
+        DisparityEngine::Ptr engine = DisparityEngine::create(FLAGS_disparity);
+
+        if (!engine)
+            return -1;
+
+        camera->setDisparityEngine(engine);
+    }
+
+    if (FLAGS_sync == "software")
+        camera->setSynchronization(ColorCamera::SOFTWARE_TRIGGER, FLAGS_max_skew);
+    else if (FLAGS_sync == "hardware")
+        camera->setSynchronization(ColorCamera::HARDWARE_TRIGGER, FLAGS_max_skew);
+
     camera->start();
 
     cv::Mat lcolor;
@@ -43,8 +61,10 @@ int main(int argc, char *argv[]) {
     int key = 0;
 
     while ((key = cv::waitKey(10)) != 0x1b) {
-        camera->captureColorL(lcolor);
-        camera->captureColorR(rcolor);
+        if (!camera->captureStereoPair(lcolor, rcolor))
+            continue;
+
+        std::cout << "skew: " << camera->lastSkew() << " [us]" << std::endl;
         camera->captureColoredPointCloud(cloud);
 
         cv::imshow("Left", lcolor);
@@ -0,0 +1,58 @@
+/**
+ * @file SyntheticCapture.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <memory>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <gflags/gflags.h>
+#include "rgbd/camera/SyntheticDepthCamera.h"
+#include "rgbd/camera/Metrics.h"
+
+using namespace rgbd;
+
+DEFINE_string(model, "ds325", "camera geometry: ds325 or pmd");
+DEFINE_double(fps, 30.0, "frame rate");
+DEFINE_string(metrics, "", "file to write the metrics to every second in JSON");
+
+int main(int argc, char *argv[]) {
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+    const bool ds325 = FLAGS_model == "ds325";
+    std::shared_ptr<DepthCamera> camera(new SyntheticDepthCamera(
+            ds325 ? SyntheticDepthCamera::DS325_MODEL : SyntheticDepthCamera::PMD_NANO_MODEL,
+            FLAGS_fps));
+    camera->start();
+
+    if (!FLAGS_metrics.empty())
+        Metrics::instance().startDump(FLAGS_metrics, 1000);
+
+    cv::namedWindow("Depth", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
+    if (ds325)
+        cv::namedWindow("Color", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
+
+    uint64_t sequence = 0;
+
+    while (cv::waitKey(1) != 0x1b) {
+        if (!camera->waitForNextFrame(sequence, 1000))
+            continue;
+
+        Frame::Ptr depth = camera->acquireDepthFrame();
+        cv::Mat d;
+        depth->data.convertTo(d, CV_8U, ds325 ? 255.0 / 1500.0 : 255.0 / 1.5);
+        cv::imshow("Depth", d);
+
+        if (ds325)
+            cv::imshow("Color", camera->acquireColorFrame()->data);
+
+        std::cout << "frame " << depth->info.sequence << ", dropped " << depth->info.dropped
+                  << "\r" << std::flush;
+    }
+
+    Metrics::instance().stopDump();
+
+    return 0;
+}
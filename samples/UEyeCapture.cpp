@@ -39,7 +39,12 @@ int main(int argc, char *argv[]) {
     cv::namedWindow("Color", CV_WINDOW_AUTOSIZE | CV_WINDOW_FREERATIO);
     int key = 0;
 
-    while ((key = cv::waitKey(10)) != 0x1b) {
+    uint64_t sequence = 0;
+
+    while ((key = cv::waitKey(1)) != 0x1b) {
+        if (!camera->waitForNextFrame(sequence, 1000))
+            continue;
+
         camera->captureRawColor(raw);
         camera->captureColor(color);
 
@@ -0,0 +1,232 @@
+/**
+ * @file BufferPool.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <cstdlib>
+#include <algorithm>
+#include <sys/mman.h>
+#include "rgbd/camera/BufferPool.h"
+
+namespace rgbd {
+
+namespace {
+
+const size_t PAGE_SIZE = 4096;
+
+size_t roundUp(size_t bytes, size_t unit) {
+    return (bytes + unit - 1) / unit * unit;
+}
+
+}
+
+/**
+ * Header in front of the data, which holds the reference count of the
+ * matrices sharing the buffer.
+ */
+struct BufferPool::Block {
+    size_t size;
+
+    int refcount;
+
+    bool mapped;
+
+    /**
+     * true if the size is rounded to huge pages.
+     */
+    bool huge;
+};
+
+BufferPool::Stats::Stats() :
+        allocations(0),
+        hits(0),
+        bytesInUse(0),
+        bytesCached(0),
+        highWater(0) {
+}
+
+BufferPool::BufferPool(size_t cacheLimit) :
+        _cacheLimit(cacheLimit),
+        _hugePages(false) {
+    static_assert(sizeof (Block) <= ALIGNMENT, "Block must fit in front of the data");
+}
+
+BufferPool::~BufferPool() {
+    trim();
+}
+
+BufferPool& BufferPool::instance() {
+    static BufferPool* pool = new BufferPool();
+
+    return *pool;
+}
+
+void BufferPool::allocate(int dims, const int* sizes, int type, int*& refcount,
+                          uchar*& datastart, uchar*& data, size_t* step) {
+    size_t bytes = CV_ELEM_SIZE(type);
+
+    for (int i = dims - 1; i >= 0; i--) {
+        step[i] = bytes;
+        bytes *= sizes[i];
+    }
+
+    Block* block = NULL;
+    size_t size;
+    bool hugePages;
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        size = sizeClass(bytes);
+        hugePages = _hugePages;
+        auto it = _free.find(size);
+
+        if (it != _free.end() && !it->second.empty()) {
+            block = it->second.back();
+            it->second.pop_back();
+            _stats.hits++;
+            _stats.bytesCached -= size;
+        }
+
+        _stats.allocations++;
+        _stats.bytesInUse += size;
+        _stats.highWater = std::max(_stats.highWater, _stats.bytesInUse);
+    }
+
+    // The system is called outside the lock, since it may take a while to
+    // map huge pages.
+    if (!block) {
+        block = allocateBlock(size, hugePages);
+
+        if (!block) {
+            boost::mutex::scoped_lock lock(_mutex);
+            _stats.bytesInUse -= size;
+            CV_Error(CV_StsNoMem, "BufferPool: out of memory");
+        }
+    }
+
+    block->refcount = 1;
+    refcount = &block->refcount;
+    datastart = data = reinterpret_cast<uchar*>(block) + ALIGNMENT;
+}
+
+void BufferPool::deallocate(int* refcount, uchar* datastart, uchar* data) {
+    Block* block = reinterpret_cast<Block*>(datastart - ALIGNMENT);
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _stats.bytesInUse -= block->size;
+
+        // A block rounded for the other huge page mode would never be
+        // requested again.
+        if (block->huge == (_hugePages && block->size >= HUGE_PAGE_SIZE) &&
+            _stats.bytesCached + block->size <= _cacheLimit) {
+            _free[block->size].push_back(block);
+            _stats.bytesCached += block->size;
+            return;
+        }
+    }
+
+    freeBlock(block);
+}
+
+void BufferPool::setHugePages(bool enabled) {
+    std::vector<Block*> blocks;
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        if (_hugePages == enabled)
+            return;
+
+        _hugePages = enabled;
+
+        // Cached blocks of a huge page or larger are rounded for the other
+        // mode, so requests would not find them any more.
+        for (auto it = _free.lower_bound(HUGE_PAGE_SIZE); it != _free.end(); it = _free.erase(it)) {
+            for (Block* block: it->second) {
+                _stats.bytesCached -= block->size;
+                blocks.push_back(block);
+            }
+        }
+    }
+
+    for (Block* block: blocks)
+        freeBlock(block);
+}
+
+BufferPool::Stats BufferPool::stats() const {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    return _stats;
+}
+
+void BufferPool::trim() {
+    std::map<size_t, std::vector<Block*>> blocks;
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        blocks.swap(_free);
+        _stats.bytesCached = 0;
+    }
+
+    for (const auto& it: blocks)
+        for (Block* block: it.second)
+            freeBlock(block);
+}
+
+size_t BufferPool::sizeClass(size_t bytes) const {
+    bytes += ALIGNMENT;
+
+    if (_hugePages && bytes >= HUGE_PAGE_SIZE)
+        return roundUp(bytes, HUGE_PAGE_SIZE);
+    else if (bytes >= PAGE_SIZE)
+        return roundUp(bytes, PAGE_SIZE);
+    else
+        return roundUp(bytes, ALIGNMENT);
+}
+
+BufferPool::Block* BufferPool::allocateBlock(size_t size, bool hugePages) {
+    void* p = NULL;
+    bool mapped = false;
+
+    if (hugePages && size >= HUGE_PAGE_SIZE) {
+#if defined(MAP_HUGETLB)
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (p == MAP_FAILED)
+            p = NULL;
+        else
+            mapped = true;
+#endif
+
+        // No huge page is reserved, so ask for transparent ones instead.
+        if (!p && posix_memalign(&p, HUGE_PAGE_SIZE, size) == 0) {
+#if defined(MADV_HUGEPAGE)
+            madvise(p, size, MADV_HUGEPAGE);
+#endif
+        }
+    } else if (posix_memalign(&p, size >= PAGE_SIZE ? PAGE_SIZE : ALIGNMENT, size) != 0) {
+        p = NULL;
+    }
+
+    if (!p)
+        return NULL;
+
+    Block* block = static_cast<Block*>(p);
+    block->size = size;
+    block->mapped = mapped;
+    block->huge = hugePages && size >= HUGE_PAGE_SIZE;
+
+    return block;
+}
+
+void BufferPool::freeBlock(Block* block) {
+    if (block->mapped)
+        munmap(block, block->size);
+    else
+        std::free(block);
+}
+
+}
@@ -0,0 +1,221 @@
+/**
+ * @file CameraGroup.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <boost/bind.hpp>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "rgbd/camera/CameraGroup.h"
+
+namespace rgbd {
+
+namespace {
+
+void pinThread(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof (set), &set) != 0)
+        std::cerr << "CameraGroup: cannot pin to CPU " << cpu << std::endl;
+#else
+    std::cerr << "CameraGroup: cannot pin threads on this platform" << std::endl;
+#endif
+}
+
+}
+
+CameraGroup::FrameSet::FrameSet() :
+        skew(0),
+        sequence(0) {
+}
+
+CameraGroup::CameraGroup(uint64_t tolerance, size_t capacity, DropPolicy policy) :
+        _tolerance(tolerance),
+        _capacity(std::max<size_t>(capacity, 1)),
+        _policy(policy),
+        _sequence(0),
+        _dropped(0),
+        _running(false) {
+}
+
+CameraGroup::~CameraGroup() {
+    stop();
+}
+
+size_t CameraGroup::add(std::shared_ptr<ColorCamera> camera, int cpu) {
+    Member member;
+    member.camera = camera;
+    member.depth = std::dynamic_pointer_cast<DepthCamera>(camera);
+    member.color = true;
+    member.cpu = cpu;
+
+    // Depth cameras without color throw from colorSize(), and would throw
+    // from acquireColorFrame() on the acquisition thread as well.
+    if (member.depth) {
+        try {
+            camera->colorSize();
+        } catch (UnsupportedException* e) {
+            delete e;
+            member.color = false;
+        }
+    }
+
+    _members.push_back(member);
+
+    return _members.size() - 1;
+}
+
+size_t CameraGroup::size() const {
+    return _members.size();
+}
+
+void CameraGroup::start() {
+    if (_running)
+        return;
+
+    _running = true;
+
+    for (size_t i = 0; i < _members.size(); i++)
+        _threads.create_thread(boost::bind(&CameraGroup::acquire, this, i));
+}
+
+void CameraGroup::stop() {
+    _running = false;
+    _threads.join_all();
+}
+
+bool CameraGroup::waitForNextSet(FrameSet& set, int timeout) {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    if (!_condition.timed_wait(lock, boost::posix_time::milliseconds(timeout), [this] {
+        return !_sets.empty();
+    }))
+        return false;
+
+    set = _sets.front();
+    _sets.pop_front();
+
+    return true;
+}
+
+uint64_t CameraGroup::dropped() const {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    return _dropped;
+}
+
+void CameraGroup::acquire(size_t index) {
+    Member& member = _members[index];
+    uint64_t last[2] = { 0, 0 };
+    uint64_t sequence = 0;
+
+    // Pinned before starting, so that the threads of the camera inherit it.
+    if (member.cpu >= 0)
+        pinThread(member.cpu);
+
+    member.camera->start();
+
+    while (_running) {
+        if (!member.camera->waitForNextFrame(sequence, 100))
+            continue;
+
+        Frame::Ptr frame = member.depth ?
+                member.depth->acquireDepthFrame() : member.camera->acquireColorFrame();
+        Frame::Ptr color = !member.depth ? frame :
+                member.color ? member.camera->acquireColorFrame() : Frame::Ptr();
+
+        if (!frame || (frame->info.hostTime == last[0] && frame->info.sequence == last[1]))
+            continue;
+
+        last[0] = frame->info.hostTime;
+        last[1] = frame->info.sequence;
+        push(index, frame, color);
+    }
+}
+
+void CameraGroup::push(size_t index, const Frame::Ptr& frame, const Frame::Ptr& color) {
+    boost::mutex::scoped_lock lock(_mutex);
+    auto& pending = _members[index].pending;
+
+    pending.push_back(std::make_pair(frame, color));
+
+    if (pending.size() > MAX_PENDING) {
+        pending.pop_front();
+        _dropped++;
+    }
+
+    assemble();
+}
+
+void CameraGroup::assemble() {
+    const size_t n = _members.size();
+
+    while (true) {
+        uint64_t newest = 0;
+
+        for (const auto& member: _members) {
+            if (member.pending.empty())
+                return;
+
+            newest = std::max(newest, member.pending.front().first->info.hostTime);
+        }
+
+        // Frames too old to match the newest head never will, since the
+        // later frames of the other cameras are even newer.
+        bool complete = true;
+        uint64_t oldest = newest;
+
+        for (auto& member: _members) {
+            auto& pending = member.pending;
+
+            while (!pending.empty() && pending.front().first->info.hostTime + _tolerance < newest) {
+                pending.pop_front();
+                _dropped++;
+            }
+
+            if (pending.empty()) {
+                complete = false;
+            } else {
+                newest = std::max(newest, pending.front().first->info.hostTime);
+                oldest = std::min(oldest, pending.front().first->info.hostTime);
+            }
+        }
+
+        if (!complete)
+            return;
+        if (newest - oldest > _tolerance)
+            continue;
+
+        FrameSet set;
+        set.frames.reserve(n);
+        set.colors.reserve(n);
+        set.skew = newest - oldest;
+
+        for (auto& member: _members) {
+            set.frames.push_back(member.pending.front().first);
+            set.colors.push_back(member.pending.front().second);
+            member.pending.pop_front();
+        }
+
+        if (_sets.size() >= _capacity) {
+            _dropped += n;
+
+            if (_policy == DROP_NEWEST)
+                continue;
+
+            _sets.pop_front();
+        }
+
+        set.sequence = ++_sequence;
+        _sets.push_back(set);
+        _condition.notify_all();
+    }
+}
+
+}
@@ -5,6 +5,8 @@
  */
 
 #include "rgbd/camera/ColorCalibrator.h"
+#include "rgbd/camera/Metrics.h"
+#include "rgbd/camera/WhiteBalance.h"
 
 namespace rgbd {
 
@@ -12,6 +14,7 @@ ColorCalibrator::ColorCalibrator(std::shared_ptr<ColorCamera> camera) :
         _camera(camera),
         _rscale(1.0),
         _bscale(1.0) {
+    buildWhiteBalanceLUT(_rscale, _bscale, _lut);
 }
 
 ColorCalibrator::~ColorCalibrator() {
@@ -25,35 +28,34 @@ void ColorCalibrator::start() {
     _camera->start();
 }
 
-void ColorCalibrator::setGrayImage(cv::Mat& gray) {
-    std::vector<cv::Mat> bgr;
-    cv::split(gray, bgr);
+bool ColorCalibrator::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return _camera->waitForNextFrame(sequence, timeout);
+}
 
-    double rsum = 0.0;
-    double bsum = 0.0;
+void ColorCalibrator::setTriggerMode(TriggerMode mode) {
+    _camera->setTriggerMode(mode);
+}
 
-    for (size_t y = 0; y < gray.rows; y++) {
-        for (size_t x = 0; x < gray.cols; x++) {
-            rsum += (double) bgr[1].at<uint8_t>(y, x) / bgr[2].at<uint8_t>(y, x);
-            bsum += (double) bgr[1].at<uint8_t>(y, x) / bgr[0].at<uint8_t>(y, x);
-        }
-    }
+void ColorCalibrator::trigger() {
+    _camera->trigger();
+}
 
-    _rscale = rsum / (gray.rows * gray.cols);
-    _bscale = bsum / (gray.rows * gray.cols);
+void ColorCalibrator::setGrayImage(cv::Mat& gray) {
+    estimateWhiteBalance(gray, _rscale, _bscale);
+    buildWhiteBalanceLUT(_rscale, _bscale, _lut);
 
     std::cout << "ColorCalibrator: rscale = " << _rscale
               << ", bscale = " << _bscale << std::endl;
 }
 
 void ColorCalibrator::captureColor(cv::Mat& buffer) {
-    _camera->captureColor(buffer);
-    std::vector<cv::Mat> bgr;
+    static Histogram& process = Metrics::instance().histogram("color_calibrator.color.process");
+    Frame::Ptr frame = _camera->acquireColorFrame();
 
-    cv::split(buffer, bgr);
-    cv::convertScaleAbs(bgr[2], bgr[2], _rscale, 0.0);
-    cv::convertScaleAbs(bgr[0], bgr[0], _bscale, 0.0);
-    cv::merge(bgr, buffer);
+    if (frame) {
+        ScopedTimer timer(process);
+        cv::LUT(frame->data, _lut, buffer);
+    }
 }
 
 void ColorCalibrator::captureRawColor(cv::Mat& buffer) {
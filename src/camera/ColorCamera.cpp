@@ -21,8 +21,36 @@ cv::Size ColorCamera::colorSize() const {
 void ColorCamera::start() {
 }
 
+bool ColorCamera::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return true;
+}
+
+void ColorCamera::setTriggerMode(TriggerMode mode) {
+    if (mode != FREE_RUN)
+        throw new UnsupportedException("setTriggerMode");
+}
+
+void ColorCamera::trigger() {
+    throw new UnsupportedException("trigger");
+}
+
 void ColorCamera::captureColor(cv::Mat& buffer) {
     throw new UnsupportedException("captureColor");
 }
 
+Frame::Ptr ColorCamera::acquireColorFrame() {
+    std::shared_ptr<Frame> frame;
+
+    {
+        boost::mutex::scoped_lock lock(_framesMutex);
+        frame = _colorFrames.allocate(colorSize(), CV_8UC3);
+    }
+
+    captureColor(frame->data);
+    frame->info = FrameInfo();
+    frame->info.hostTime = FrameInfo::now();
+
+    return frame;
+}
+
 }
@@ -5,12 +5,13 @@
  */
 
 #include "rgbd/camera/ColorRotator.h"
+#include "rgbd/camera/Rotate.h"
+#include "rgbd/camera/Metrics.h"
 
 namespace rgbd {
 
 ColorRotator::ColorRotator(std::shared_ptr<ColorCamera> camera, int angle) :
         _camera(camera),
-        _cbuffer(cv::Mat::zeros(camera->colorSize(), CV_8UC3)),
         _angle(angle) {
     if (_angle == 0 || _angle == 180 || _angle == -180) {
         _csize = camera->colorSize();
@@ -33,19 +34,25 @@ void ColorRotator::start() {
     _camera->start();
 }
 
+bool ColorRotator::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return _camera->waitForNextFrame(sequence, timeout);
+}
+
+void ColorRotator::setTriggerMode(TriggerMode mode) {
+    _camera->setTriggerMode(mode);
+}
+
+void ColorRotator::trigger() {
+    _camera->trigger();
+}
+
 void ColorRotator::captureColor(cv::Mat& buffer) {
-    _camera->captureColor(_cbuffer);
-
-    if (_angle == 0) {
-        _cbuffer.copyTo(buffer);
-    } else if (_angle == 90) {
-        cv::transpose(_cbuffer, buffer);
-        cv::flip(buffer, buffer, 0);
-    } else if (_angle == -90) {
-        cv::transpose(_cbuffer, buffer);
-        cv::flip(buffer, buffer, 1);
-    } else {
-        cv::flip(_cbuffer, buffer, -1);
+    static Histogram& process = Metrics::instance().histogram("rotator.color.process");
+    Frame::Ptr frame = _camera->acquireColorFrame();
+
+    if (frame) {
+        ScopedTimer timer(process);
+        rotateImage(frame->data, buffer, _angle);
     }
 }
 
@@ -4,15 +4,112 @@
  * @date Jul 29, 2013
  */
 
+#include <limits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "rgbd/camera/DS325.h"
 
 namespace rgbd {
 
+namespace {
+
+/**
+ * Convert UV coordinates to offsets of the nearest pixels in the color image.
+ * Pixel x covers u from x / width to (x + 1) / width, so that its center is
+ * at the same place as in sampleBilinear().
+ *
+ * @param uv UV coordinates
+ * @param size Number of coordinates
+ * @param csize Size of the color image
+ * @param offsets Returned pixel offsets, or -1 for invalid coordinates
+ */
+void uvToOffsets(const UV* uv, size_t size, const cv::Size& csize, int* offsets) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128 width = _mm_set1_ps(csize.width);
+    const __m128 height = _mm_set1_ps(csize.height);
+    const __m128 xmax = _mm_set1_ps(csize.width - 1);
+    const __m128 ymax = _mm_set1_ps(csize.height - 1);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 invalid = _mm_set1_ps(-FLT_MAX);
+
+    for (; i + 4 <= size; i += 4) {
+        const float* p = reinterpret_cast<const float*>(uv + i);
+        __m128 a = _mm_loadu_ps(p);
+        __m128 b = _mm_loadu_ps(p + 4);
+        __m128 u = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 v = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 valid = _mm_and_ps(_mm_cmpneq_ps(u, invalid), _mm_cmpneq_ps(v, invalid));
+
+        // Truncation floors the coordinates, which are clamped to 0 or more.
+        __m128i x = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(u, width), zero), xmax));
+        __m128i y = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(v, height), zero), ymax));
+        // Exact in float as long as the image has less than 2^24 pixels.
+        __m128i offset = _mm_cvtps_epi32(_mm_add_ps(
+                _mm_mul_ps(_mm_cvtepi32_ps(y), width), _mm_cvtepi32_ps(x)));
+        __m128i mask = _mm_castps_si128(valid);
+        offset = _mm_or_si128(_mm_and_si128(mask, offset),
+                              _mm_andnot_si128(mask, _mm_set1_epi32(-1)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(offsets + i), offset);
+    }
+#endif
+
+    for (; i < size; i++) {
+        if (uv[i].u == -FLT_MAX || uv[i].v == -FLT_MAX) {
+            offsets[i] = -1;
+            continue;
+        }
+
+        int x = std::min(std::max(cvFloor(uv[i].u * csize.width), 0), csize.width - 1);
+        int y = std::min(std::max(cvFloor(uv[i].v * csize.height), 0), csize.height - 1);
+        offsets[i] = y * csize.width + x;
+    }
+}
+
+/**
+ * Sample the color image at UV coordinates with bilinear interpolation.
+ *
+ * @param color Color image of CV_8UC3
+ * @param uv UV coordinate which must be valid
+ * @param point Returned point whose color is set
+ */
+void sampleBilinear(const cv::Mat& color, const UV& uv, pcl::PointXYZRGB& point) {
+    float x = std::min(std::max(uv.u * color.cols - 0.5f, 0.0f), color.cols - 1.0f);
+    float y = std::min(std::max(uv.v * color.rows - 0.5f, 0.0f), color.rows - 1.0f);
+    int x0 = (int) x;
+    int y0 = (int) y;
+    int dx = x0 + 1 < color.cols ? 3 : 0;
+    float fx = x - x0;
+    float fy = y - y0;
+
+    const uchar* p0 = color.ptr<uchar>(y0) + 3 * x0;
+    const uchar* p1 = y0 + 1 < color.rows ? p0 + color.step : p0;
+    float bgr[3];
+
+    for (int c = 0; c < 3; c++) {
+        float top = p0[c] + fx * (p0[c + dx] - p0[c]);
+        float bottom = p1[c] + fx * (p1[c + dx] - p1[c]);
+        bgr[c] = top + fy * (bottom - top) + 0.5f;
+    }
+
+    point.b = (uint8_t) bgr[0];
+    point.g = (uint8_t) bgr[1];
+    point.r = (uint8_t) bgr[2];
+}
+
+}
+
 DS325::DS325(const size_t deviceNo, const DepthSense::FrameFormat frameFormat) :
         DepthCamera(),
         _format(frameFormat),
         _compression(COMPRESSION_TYPE_MJPEG),
         _dsize(320, 240),
+        _ddropped(0),
+        _cdropped(0),
+        _interpolation(cv::INTER_NEAREST),
         _context(Context::create("localhost")) {
     if (_format == FRAME_FORMAT_WXGA_H) {
         _csize.width = 1280;
@@ -29,6 +126,18 @@ DS325::DS325(const size_t deviceNo, const DepthSense::FrameFormat frameFormat) :
         std::exit(-1);
     }
 
+    const std::string name = "ds325." + std::to_string(deviceNo);
+    Metrics& metrics = Metrics::instance();
+    _dframes.instrument(name + ".depth");
+    _aframes.instrument(name + ".amplitude");
+    _cframes.instrument(name + ".color");
+    _dcopy = &metrics.histogram(name + ".depth.copy");
+    _ccopy = &metrics.histogram(name + ".color.copy");
+    _vcopy = &metrics.histogram(name + ".vertex.copy");
+    _vlockWait = &metrics.histogram(name + ".vertex.lock_wait");
+    _ddeviceDropped = &metrics.counter(name + ".depth.device_dropped");
+    _cdeviceDropped = &metrics.counter(name + ".color.device_dropped");
+
     _context.deviceAddedEvent().connect(this, &DS325::onDeviceConnected);
     _context.deviceRemovedEvent().connect(this, &DS325::onDeviceDisconnected);
     std::vector<Device> devices = _context.getDevices();
@@ -85,69 +194,124 @@ void DS325::start() {
     sleep(3);
 }
 
+bool DS325::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return _dframes.waitForNext(sequence, timeout);
+}
+
 void DS325::captureDepth(cv::Mat& buffer) {
-    boost::mutex::scoped_lock lock(_dmutex);
-    std::memcpy(buffer.data, _ddata.depthMap, _ddata.depthMap.size() * 2);
+    Frame::Ptr frame = _dframes.latest();
+
+    if (frame)
+        frame->data.copyTo(buffer);
 }
 
 void DS325::captureAmplitude(cv::Mat& buffer) {
-    boost::mutex::scoped_lock lock(_dmutex);
-    std::memcpy(buffer.data, _ddata.confidenceMap, _ddata.confidenceMap.size() * 2);
+    Frame::Ptr frame = _aframes.latest();
+
+    if (frame)
+        frame->data.copyTo(buffer);
 }
 
 void DS325::captureColor(cv::Mat& buffer) {
-    boost::mutex::scoped_lock lock(_cmutex);
+    Frame::Ptr frame = _cframes.latest();
 
-    if (_compression == COMPRESSION_TYPE_YUY2)
-        buffer = cv::Mat::zeros(_csize, CV_8UC2);
+    if (frame)
+        frame->data.copyTo(buffer);
+}
 
-    std::memcpy(buffer.data, _cdata.colorMap, _cdata.colorMap.size());
+Frame::Ptr DS325::acquireDepthFrame() {
+    return _dframes.latest();
+}
 
-    if (_compression == COMPRESSION_TYPE_YUY2)
-        cv::cvtColor(buffer, buffer, CV_YUV2BGR_YUY2);
+Frame::Ptr DS325::acquireAmplitudeFrame() {
+    return _aframes.latest();
+}
+
+Frame::Ptr DS325::acquireColorFrame() {
+    return _cframes.latest();
 }
 
 void DS325::capturePointCloud(PointCloud::Ptr buffer) {
+    const uint64_t start = Metrics::now();
     boost::mutex::scoped_lock lock(_dmutex);
-    std::size_t index = 0;
-
-    for (auto& point: buffer->points) {
-        auto& f = _ddata.verticesFloatingPoint[index++];
+    _vlockWait->record(Metrics::now() - start);
+    _dsamples.update();
+    const DepthSample& sample = _dsamples.front();
+    std::size_t size = std::min(buffer->points.size(), sample.vertices.size());
+    stampHeader(buffer->header, sample.info);
+
+    for (std::size_t index = 0; index < size; index++) {
+        auto& point = buffer->points[index];
+        auto& f = sample.vertices[index];
         point.x = f.x;
         point.y = f.y;
         point.z = f.z;
     }
 }
 
-void rgbd::DS325::captureColoredPointCloud(ColoredPointCloud::Ptr buffer) {
-    cv::Mat color = cv::Mat::zeros(_csize, CV_8UC3);
-    captureColor(color);
+void DS325::captureColoredPointCloud(ColoredPointCloud::Ptr buffer) {
+    Frame::Ptr color = _cframes.latest();
+
+    if (!color)
+        return;
 
+    const uint64_t start = Metrics::now();
     boost::mutex::scoped_lock dlock(_dmutex);
-    buffer->points.clear();
+    _vlockWait->record(Metrics::now() - start);
+    _dsamples.update();
+    const DepthSample& sample = _dsamples.front();
+    const size_t size = sample.vertices.size();
+
+    if (size == 0)
+        return;
+
+    stampHeader(buffer->header, sample.info);
+    buffer->points.resize(size);
+
+    if (size == _dsize.area()) {
+        buffer->width = _dsize.width;
+        buffer->height = _dsize.height;
+    } else {
+        buffer->width = size;
+        buffer->height = 1;
+    }
+
+    buffer->is_dense = false;
+    _offsets.resize(size);
+    uvToOffsets(sample.uvMap.data(), size, color->data.size(), _offsets.data());
+
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const cv::Vec3b* pixels = color->data.ptr<cv::Vec3b>();
 
-    for (size_t i = 0; i < _ddata.verticesFloatingPoint.size(); i++) {
-        auto& f = _ddata.verticesFloatingPoint[i];
-        auto& uv = _ddata.uvMap[i];
+    for (size_t i = 0; i < size; i++) {
+        auto& point = buffer->points[i];
 
-        if (uv.u == -FLT_MAX || uv.v == -FLT_MAX)
+        if (_offsets[i] < 0) {
+            point.x = point.y = point.z = nan;
+            point.rgb = 0;
             continue;
+        }
 
-        // TODO: More accurate coloring
-        auto& p = color.at<cv::Vec3b>(cvRound(uv.v * _csize.height),
-                                      cvRound(uv.u * _csize.width));
-        pcl::PointXYZRGB point;
+        auto& f = sample.vertices[i];
         point.x = f.x;
         point.y = f.y;
         point.z = f.z;
-        point.b = p[0];
-        point.g = p[1];
-        point.r = p[2];
 
-        buffer->points.push_back(point);
+        if (_interpolation == cv::INTER_LINEAR) {
+            sampleBilinear(color->data, sample.uvMap[i], point);
+        } else {
+            auto& p = pixels[_offsets[i]];
+            point.b = p[0];
+            point.g = p[1];
+            point.r = p[2];
+        }
     }
 }
 
+void DS325::setColorInterpolation(int interpolation) {
+    _interpolation = interpolation;
+}
+
 void DS325::captureAudio(std::vector<uchar>& buffer) {
     boost::mutex::scoped_lock lock(_amutex_);
     buffer.clear();
@@ -158,10 +322,8 @@ void DS325::captureAudio(std::vector<uchar>& buffer) {
 
 void DS325::captureAcceleration(cv::Point3f& buffer) {
     boost::mutex::scoped_lock lock(_dmutex);
-
-    buffer.x = _ddata.acceleration.x;
-    buffer.y = _ddata.acceleration.y;
-    buffer.z = _ddata.acceleration.z;
+    _dsamples.update();
+    buffer = _dsamples.front().acceleration;
 }
 
 void DS325::onDeviceConnected(Context context, Context::DeviceAddedData data) {
@@ -180,20 +342,66 @@ void DS325::onNewDepthSample(DepthNode node, DepthNode::NewSampleReceivedData da
     int width, height;
     FrameFormat_toResolution(data.captureConfiguration.frameFormat, &width, &height);
 
+    FrameInfo info;
+    info.hostTime = FrameInfo::now();
+    info.deviceTime = data.timeOfCapture;
+    info.dropped = _ddropped += data.droppedSampleCount;
+    _ddeviceDropped->add(data.droppedSampleCount);
+
+    std::shared_ptr<Frame> frame = _dframes.allocate(_dsize, CV_16U);
+    std::shared_ptr<Frame> amplitude = _aframes.allocate(_dsize, CV_16U);
+
     {
-        boost::mutex::scoped_lock lock(_dmutex);
-        _ddata = data;
+        ScopedTimer timer(*_dcopy);
+        std::memcpy(frame->data.data, data.depthMap, data.depthMap.size() * 2);
+        std::memcpy(amplitude->data.data, data.confidenceMap, data.confidenceMap.size() * 2);
     }
+
+    frame->info = info;
+    amplitude->info = info;
+    _aframes.publish(amplitude);
+    _dframes.publish(frame);
+
+    // Copy into the back buffer so that the SDK thread never waits for consumers.
+    DepthSample& sample = _dsamples.back();
+
+    {
+        ScopedTimer timer(*_vcopy);
+        const FPVertex* vertices = data.verticesFloatingPoint;
+        const UV* uvMap = data.uvMap;
+        sample.vertices.assign(vertices, vertices + data.verticesFloatingPoint.size());
+        sample.uvMap.assign(uvMap, uvMap + data.uvMap.size());
+    }
+    sample.acceleration.x = data.acceleration.x;
+    sample.acceleration.y = data.acceleration.y;
+    sample.acceleration.z = data.acceleration.z;
+    sample.info = frame->info;
+    _dsamples.publish();
 }
 
 void DS325::onNewColorSample(ColorNode node, ColorNode::NewSampleReceivedData data) {
     int width, height;
     FrameFormat_toResolution(data.captureConfiguration.frameFormat, &width, &height);
 
+    // Decode once here rather than on every capture.
+    std::shared_ptr<Frame> frame = _cframes.allocate(_csize, CV_8UC3);
+    frame->info.hostTime = FrameInfo::now();
+    frame->info.deviceTime = data.timeOfCapture;
+    frame->info.dropped = _cdropped += data.droppedSampleCount;
+    _cdeviceDropped->add(data.droppedSampleCount);
+
     {
-        boost::mutex::scoped_lock lock(_cmutex);
-        _cdata = data;
+        ScopedTimer timer(*_ccopy);
+
+        if (_compression == COMPRESSION_TYPE_YUY2) {
+            cv::Mat yuy2(_csize, CV_8UC2, (void*) (const uint8_t*) data.colorMap);
+            cv::cvtColor(yuy2, frame->data, CV_YUV2BGR_YUY2);
+        } else {
+            std::memcpy(frame->data.data, data.colorMap, data.colorMap.size());
+        }
     }
+
+    _cframes.publish(frame);
 }
 
 void DS325::onNewAudioSample(AudioNode node, AudioNode::NewSampleReceivedData data) {
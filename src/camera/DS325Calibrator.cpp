@@ -4,54 +4,208 @@
  * @date Jun 18, 2014
  */
 
+#include <climits>
 #include "rgbd/camera/DS325Calibrator.h"
+#include "rgbd/camera/Metrics.h"
 
 namespace rgbd {
 
+namespace {
+
+/**
+ * Source coordinate sampled by cv::resize with linear interpolation.
+ *
+ * @param x Destination coordinate
+ * @param src Source length
+ * @param dst Destination length
+ * @return Source coordinate clamped into the source
+ */
+inline float resizeCoord(float x, int src, int dst) {
+    float sx = (x + 0.5f) * src / dst - 0.5f;
+
+    return std::min(std::max(sx, 0.0f), src - 1.0f);
+}
+
+/**
+ * Sample the rectification maps at the coordinates given by resizing roi
+ * to size, which composes the remap with the following crop and resize.
+ */
+void composeRectify(const cv::Mat* maps, const cv::Rect& roi, const cv::Size& size,
+                    cv::Mat& x, cv::Mat& y) {
+    cv::Mat rx(size, CV_32F), ry(size, CV_32F);
+
+    for (int v = 0; v < size.height; v++) {
+        float* px = rx.ptr<float>(v);
+        float* py = ry.ptr<float>(v);
+        const float sy = roi.y + resizeCoord(v, roi.height, size.height);
+
+        for (int u = 0; u < size.width; u++) {
+            px[u] = roi.x + resizeCoord(u, roi.width, size.width);
+            py[u] = sy;
+        }
+    }
+
+    cv::remap(maps[0], x, rx, ry, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    cv::remap(maps[1], y, rx, ry, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+}
+
+/**
+ * Remap depth to the nearest of the four neighboring source pixels instead
+ * of blending them, so that foreground and background never mix at edges.
+ * Pixels outside the image (0) or beyond the maximum depth are invalid, and
+ * a result without any valid neighbor is invalid as well.
+ */
+class MinDepthRemapper: public cv::ParallelLoopBody {
+public:
+    MinDepthRemapper(const cv::Mat& source, cv::Mat& result, const cv::Mat& map,
+                     ushort maxDepth) :
+            _source(source),
+            _result(result),
+            _map(map),
+            _maxDepth(maxDepth) {
+    }
+
+    void operator()(const cv::Range& range) const {
+        const int width = _source.cols - 1;
+        const int height = _source.rows - 1;
+
+        for (int v = range.start; v < range.end; v++) {
+            const cv::Vec2s* map = _map.ptr<cv::Vec2s>(v);
+            ushort* result = _result.ptr<ushort>(v);
+
+            for (int u = 0; u < _result.cols; u++) {
+                const int x = map[u][0];
+                const int y = map[u][1];
+
+                if (x < 0 || y < 0 || x > width || y > height) {
+                    result[u] = 0;
+                    continue;
+                }
+
+                result[u] = sample(x, y, std::min(x + 1, width), std::min(y + 1, height));
+            }
+        }
+    }
+
+private:
+    const cv::Mat& _source;
+
+    cv::Mat& _result;
+
+    const cv::Mat& _map;
+
+    const ushort _maxDepth;
+
+    inline ushort sample(int x0, int y0, int x1, int y1) const {
+        const ushort* r0 = _source.ptr<ushort>(y0);
+        const ushort* r1 = _source.ptr<ushort>(y1);
+        const ushort taps[4] = { r0[x0], r0[x1], r1[x0], r1[x1] };
+        ushort depth = USHRT_MAX;
+        ushort saturated = 0;
+
+        for (int i = 0; i < 4; i++) {
+            // 0 wraps around to USHRT_MAX and drops out of the minimum.
+            ushort key = (ushort) (taps[i] - 1);
+            bool valid = key < _maxDepth;
+            depth = std::min(depth, valid ? key : (ushort) USHRT_MAX);
+            saturated |= !valid && taps[i] != 0;
+        }
+
+        if (depth != USHRT_MAX)
+            return depth + 1;
+
+        return saturated ? _maxDepth : 0;
+    }
+};
+
+}
+
+const cv::Rect DS325CalibWorker::DEPTH_CROP(40, 43, 498, 498 / 4 * 3);
+
 DS325CalibWorker::DS325CalibWorker(const std::string& params) :
         _csize(640, 480),
-        _dsize(320, 240) {
+        _dsize(320, 240),
+        _interpolation(cv::INTER_LINEAR) {
     loadParameters(params);
+    buildColorMaps();
 }
 
 DS325CalibWorker::~DS325CalibWorker() {
 }
 
-void DS325CalibWorker::calibrateColor(cv::Mat& source, cv::Mat& result) {
-    cv::Mat temp;
-
-    cv::remap(source, temp, _rectifyMaps[0][0], _rectifyMaps[0][1], CV_INTER_LINEAR);
-    cv::resize(temp(validROI[0]), result, _csize);
+void DS325CalibWorker::calibrateColor(const cv::Mat& source, cv::Mat& result) {
+    cv::remap(source, result, _colorMaps[0], _colorMaps[1], CV_INTER_LINEAR);
 }
 
-void DS325CalibWorker::calibrateDepth(cv::Mat& source, cv::Mat& result) {
+void DS325CalibWorker::calibrateDepth(const cv::Mat& source, cv::Mat& result) {
     const uint MAX_DEPTH = 1000;
-    const uint MIN_DEPTH = 0;
 
-    // I'm not sure why this is neccesary.
-    cv::Mat maxDist = cv::Mat::ones(_csize, CV_16U) * MAX_DEPTH;
-    cv::Mat minDist = cv::Mat::ones(_csize, CV_16U) * MIN_DEPTH;
-    cv::Mat scaled;
-    cv::resize(source, scaled, _csize);
-    cv::min(scaled, maxDist, scaled);
-    scaled -= minDist;
+    if (source.size() != _depthSource)
+        buildDepthMaps(source.size());
 
-    cv::Mat cropped = scaled(cv::Rect(40, 43, 498, 498 / 4 * 3)); // TODO
-    cv::resize(cropped, cropped, _csize);
-    cv::Mat temp;
-    cv::remap(cropped, temp, _rectifyMaps[1][0], _rectifyMaps[1][1], CV_INTER_LINEAR);
-    cv::resize(temp(validROI[1]), result, _dsize);
+    if (_interpolation == INTER_MIN_DEPTH) {
+        result.create(_dsize, CV_16U);
+        cv::parallel_for_(cv::Range(0, _dsize.height),
+                          MinDepthRemapper(source, result, _depthMaps[0], MAX_DEPTH));
+        return;
+    }
+
+    // Saturated and low confidence codes are clamped before interpolating,
+    // so that they do not blend with valid neighbors into plausible depth.
+    cv::min(source, MAX_DEPTH, _clamped);
+
+    if (_interpolation == cv::INTER_NEAREST)
+        cv::remap(_clamped, result, _depthNearest, cv::Mat(), CV_INTER_NN);
+    else
+        cv::remap(_clamped, result, _depthMaps[0], _depthMaps[1], CV_INTER_LINEAR);
+}
+
+void DS325CalibWorker::setDepthInterpolation(int interpolation) {
+    _interpolation = interpolation;
 }
 
-void DS325CalibWorker::calibrateAmplitude(cv::Mat& source, cv::Mat& result) {
-    cv::Mat scaled;
-    cv::resize(source, scaled, _csize);
+void DS325CalibWorker::calibrateAmplitude(const cv::Mat& source, cv::Mat& result) {
+    if (source.size() != _depthSource)
+        buildDepthMaps(source.size());
+
+    cv::remap(source, result, _depthMaps[0], _depthMaps[1], CV_INTER_LINEAR);
+}
 
-    cv::Mat cropped = scaled(cv::Rect(40, 43, 498, 498 / 4 * 3)); // TODO
-    cv::resize(cropped, cropped, _csize);
-    cv::Mat temp;
-    cv::remap(cropped, temp, _rectifyMaps[1][0], _rectifyMaps[1][1], CV_INTER_LINEAR);
-    cv::resize(temp(validROI[1]), result, _dsize);
+void DS325CalibWorker::buildColorMaps() {
+    // remap -> crop to validROI -> resize to color size
+    cv::Mat x, y;
+    composeRectify(_rectifyMaps[0], validROI[0], _csize, x, y);
+    cv::convertMaps(x, y, _colorMaps[0], _colorMaps[1], CV_16SC2);
+}
+
+void DS325CalibWorker::buildDepthMaps(const cv::Size& source) {
+    // resize to color size -> crop -> resize to color size -> remap
+    // -> crop to validROI -> resize to depth size
+    cv::Mat x, y;
+    composeRectify(_rectifyMaps[1], validROI[1], _dsize, x, y);
+
+    for (int v = 0; v < _dsize.height; v++) {
+        float* px = x.ptr<float>(v);
+        float* py = y.ptr<float>(v);
+
+        for (int u = 0; u < _dsize.width; u++) {
+            // Pixels rectified from outside the image stay outside of it.
+            if (px[u] < 0 || px[u] > _csize.width - 1 || py[u] < 0 || py[u] > _csize.height - 1) {
+                px[u] = py[u] = -10.0f;
+                continue;
+            }
+
+            float sx = DEPTH_CROP.x + resizeCoord(px[u], DEPTH_CROP.width, _csize.width);
+            float sy = DEPTH_CROP.y + resizeCoord(py[u], DEPTH_CROP.height, _csize.height);
+            px[u] = resizeCoord(sx, source.width, _csize.width);
+            py[u] = resizeCoord(sy, source.height, _csize.height);
+        }
+    }
+
+    cv::convertMaps(x, y, _depthMaps[0], _depthMaps[1], CV_16SC2);
+    cv::Mat unused;
+    cv::convertMaps(x, y, _depthNearest, unused, CV_16SC2, true);
+    _depthSource = source;
 }
 
 void DS325CalibWorker::loadParameters(const std::string& params) {
@@ -87,9 +241,9 @@ void DS325CalibWorker::loadParameters(const std::string& params) {
     }
 
     cv::initUndistortRectifyMap(cameraMatrix[0], distCoeffs[0], R1, P1,
-                                _csize, CV_16SC2, _rectifyMaps[0][0], _rectifyMaps[0][1]);
+                                _csize, CV_32FC1, _rectifyMaps[0][0], _rectifyMaps[0][1]);
     cv::initUndistortRectifyMap(cameraMatrix[1], distCoeffs[1], R2, P2,
-                                _csize, CV_16SC2, _rectifyMaps[1][0], _rectifyMaps[1][1]);
+                                _csize, CV_32FC1, _rectifyMaps[1][0], _rectifyMaps[1][1]);
 }
 
 DS325Calibrator::DS325Calibrator(std::shared_ptr<DS325> camera,
@@ -106,18 +260,37 @@ DS325Calibrator::~DS325Calibrator() {
 }
 
 void DS325Calibrator::captureColor(cv::Mat& buffer) {
-    _camera->captureColor(buffer);
-    _calib.calibrateColor(buffer, buffer);
+    static Histogram& process = Metrics::instance().histogram("ds325_calibrator.color.process");
+    Frame::Ptr frame = _camera->acquireColorFrame();
+
+    if (frame) {
+        ScopedTimer timer(process);
+        _calib.calibrateColor(frame->data, buffer);
+    }
 }
 
 void DS325Calibrator::captureDepth(cv::Mat& buffer) {
-    _camera->captureDepth(buffer);
-    _calib.calibrateDepth(buffer, buffer);
+    static Histogram& process = Metrics::instance().histogram("ds325_calibrator.depth.process");
+    Frame::Ptr frame = _camera->acquireDepthFrame();
+
+    if (frame) {
+        ScopedTimer timer(process);
+        _calib.calibrateDepth(frame->data, buffer);
+    }
 }
 
 void DS325Calibrator::captureAmplitude(cv::Mat& buffer) {
-    _camera->captureAmplitude(buffer);
-    _calib.calibrateAmplitude(buffer, buffer);
+    static Histogram& process = Metrics::instance().histogram("ds325_calibrator.amplitude.process");
+    Frame::Ptr frame = _camera->acquireAmplitudeFrame();
+
+    if (frame) {
+        ScopedTimer timer(process);
+        _calib.calibrateAmplitude(frame->data, buffer);
+    }
+}
+
+void DS325Calibrator::setDepthInterpolation(int interpolation) {
+    _calib.setDepthInterpolation(interpolation);
 }
 
 void DS325Calibrator::capturePointCloud(PointCloud::Ptr buffer) {
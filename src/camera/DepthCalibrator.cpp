@@ -27,6 +27,10 @@ void DepthCalibrator::start() {
     return _camera->start();
 }
 
+bool DepthCalibrator::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return _camera->waitForNextFrame(sequence, timeout);
+}
+
 void DepthCalibrator::captureRawColor(cv::Mat& buffer) {
     _camera->captureColor(buffer);
 }
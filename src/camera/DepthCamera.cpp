@@ -29,11 +29,39 @@ void DepthCamera::start() {
         _camera->start();
 }
 
+bool DepthCamera::waitForNextFrame(uint64_t& sequence, int timeout) {
+    if (_camera)
+        return _camera->waitForNextFrame(sequence, timeout);
+    else
+        return true;
+}
+
+void DepthCamera::setTriggerMode(TriggerMode mode) {
+    if (_camera)
+        _camera->setTriggerMode(mode);
+    else
+        ColorCamera::setTriggerMode(mode);
+}
+
+void DepthCamera::trigger() {
+    if (_camera)
+        _camera->trigger();
+    else
+        ColorCamera::trigger();
+}
+
 void DepthCamera::captureColor(cv::Mat& buffer) {
     if (_camera)
         _camera->captureColor(buffer);
 }
 
+Frame::Ptr DepthCamera::acquireColorFrame() {
+    if (_camera)
+        return _camera->acquireColorFrame();
+    else
+        return ColorCamera::acquireColorFrame();
+}
+
 cv::Size DepthCamera::depthSize() const {
     throw new UnsupportedException("depthSize");
 }
@@ -42,10 +70,40 @@ void DepthCamera::captureDepth(cv::Mat& buffer) {
     throw new UnsupportedException("captureDepth");
 }
 
+Frame::Ptr DepthCamera::acquireDepthFrame() {
+    std::shared_ptr<Frame> frame;
+
+    {
+        boost::mutex::scoped_lock lock(_framesMutex);
+        frame = _depthFrames.allocate();
+    }
+
+    captureDepth(frame->data);
+    frame->info = FrameInfo();
+    frame->info.hostTime = FrameInfo::now();
+
+    return frame;
+}
+
 void DepthCamera::captureAmplitude(cv::Mat& buffer) {
     throw new UnsupportedException("captureAmplitude");
 }
 
+Frame::Ptr DepthCamera::acquireAmplitudeFrame() {
+    std::shared_ptr<Frame> frame;
+
+    {
+        boost::mutex::scoped_lock lock(_framesMutex);
+        frame = _amplitudeFrames.allocate();
+    }
+
+    captureAmplitude(frame->data);
+    frame->info = FrameInfo();
+    frame->info.hostTime = FrameInfo::now();
+
+    return frame;
+}
+
 void DepthCamera::capturePointCloud(PointCloud::Ptr buffer) {
     throw new UnsupportedException("captureVertex");
 }
@@ -54,4 +112,9 @@ void DepthCamera::captureColoredPointCloud(ColoredPointCloud::Ptr buffer) {
     throw new UnsupportedException("captureColoredVertex");
 }
 
+void DepthCamera::stampHeader(pcl::PCLHeader& header, const FrameInfo& info) {
+    header.stamp = info.hostTime;
+    header.seq = info.sequence;
+}
+
 }
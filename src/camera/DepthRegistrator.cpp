@@ -0,0 +1,496 @@
+/**
+ * @file DepthRegistrator.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <cmath>
+#include <limits>
+#include <climits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "rgbd/camera/DepthRegistrator.h"
+#include "rgbd/camera/Metrics.h"
+
+namespace rgbd {
+
+namespace {
+
+/**
+ * Points nearer to the color camera than this are dropped before the
+ * perspective division.
+ */
+const float ZMIN = 1.0e-3f;
+
+inline void setColor(pcl::PointXYZ& point, const cv::Vec3b* color) {
+}
+
+inline void setColor(pcl::PointXYZRGB& point, const cv::Vec3b* color) {
+    point.b = (*color)[0];
+    point.g = (*color)[1];
+    point.r = (*color)[2];
+}
+
+/**
+ * Compute the normalized undistorted coordinates of every pixel.
+ */
+void computeRays(const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs, const cv::Size& size,
+                 cv::Mat* rays) {
+    cv::Mat pixels(1, size.area(), CV_32FC2);
+    cv::Mat normalized;
+    cv::Point2f* p = pixels.ptr<cv::Point2f>();
+
+    for (int y = 0; y < size.height; y++)
+        for (int x = 0; x < size.width; x++)
+            *p++ = cv::Point2f(x, y);
+
+    cv::undistortPoints(pixels, normalized, cameraMatrix, distCoeffs);
+    rays[0].create(size, CV_32F);
+    rays[1].create(size, CV_32F);
+
+    const cv::Point2f* n = normalized.ptr<cv::Point2f>();
+    float* rx = rays[0].ptr<float>();
+    float* ry = rays[1].ptr<float>();
+
+    for (int i = 0; i < size.area(); i++) {
+        rx[i] = n[i].x;
+        ry[i] = n[i].y;
+    }
+}
+
+/**
+ * Project rows of depth in meters into the color camera. Each pixel gets
+ * the top-left corner of its square in the color image and its depth from
+ * the color camera, which is 0 if the depth is invalid or the point cannot
+ * be seen.
+ */
+class DepthProjector: public cv::ParallelLoopBody {
+public:
+    DepthProjector(const cv::Mat& depth, const cv::Mat* rays, const cv::Matx33f& rotation,
+                   const cv::Vec3f& translation, const float* color, float maxRadius2,
+                   float maxDepth, float offset, cv::Mat& targets, cv::Mat& zs) :
+            _depth(depth),
+            _rays(rays),
+            _R(rotation),
+            _t(translation),
+            _color(color),
+            _maxRadius2(maxRadius2),
+            _maxDepth(maxDepth),
+            _offset(offset),
+            _targets(targets),
+            _zs(zs) {
+    }
+
+    void operator()(const cv::Range& range) const {
+        for (int y = range.start; y < range.end; y++)
+            projectRow(y);
+    }
+
+private:
+    const cv::Mat& _depth;
+
+    const cv::Mat* _rays;
+
+    const cv::Matx33f _R;
+
+    const cv::Vec3f _t;
+
+    const float* _color;
+
+    const float _maxRadius2;
+
+    const float _maxDepth;
+
+    const float _offset;
+
+    cv::Mat& _targets;
+
+    cv::Mat& _zs;
+
+    void projectRow(int y) const {
+        const int cols = _depth.cols;
+        const float* depth = _depth.ptr<float>(y);
+        const float* rx = _rays[0].ptr<float>(y);
+        const float* ry = _rays[1].ptr<float>(y);
+        int* targets = _targets.ptr<int>(y);
+        float* zs = _zs.ptr<float>(y);
+        int x = 0;
+
+#if defined(__SSE2__)
+        const cv::Matx33f& R = _R;
+        const float* c = _color;
+        const __m128 r00 = _mm_set1_ps(R(0, 0)), r01 = _mm_set1_ps(R(0, 1));
+        const __m128 r02 = _mm_set1_ps(R(0, 2)), r10 = _mm_set1_ps(R(1, 0));
+        const __m128 r11 = _mm_set1_ps(R(1, 1)), r12 = _mm_set1_ps(R(1, 2));
+        const __m128 r20 = _mm_set1_ps(R(2, 0)), r21 = _mm_set1_ps(R(2, 1));
+        const __m128 r22 = _mm_set1_ps(R(2, 2));
+        const __m128 t0 = _mm_set1_ps(_t[0]), t1 = _mm_set1_ps(_t[1]), t2 = _mm_set1_ps(_t[2]);
+        const __m128 fx = _mm_set1_ps(c[0]), fy = _mm_set1_ps(c[1]);
+        const __m128 cx = _mm_set1_ps(c[2] - _offset), cy = _mm_set1_ps(c[3] - _offset);
+        const __m128 k1 = _mm_set1_ps(c[4]), k2 = _mm_set1_ps(c[5]);
+        const __m128 p1 = _mm_set1_ps(c[6]), p2 = _mm_set1_ps(c[7]);
+        const __m128 k3 = _mm_set1_ps(c[8]), k4 = _mm_set1_ps(c[9]);
+        const __m128 k5 = _mm_set1_ps(c[10]), k6 = _mm_set1_ps(c[11]);
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+        const __m128 zmin = _mm_set1_ps(ZMIN), maxr2 = _mm_set1_ps(_maxRadius2);
+        const __m128 zmax = _mm_set1_ps(_maxDepth);
+
+        for (; x + 4 <= cols; x += 4) {
+            __m128 Z = _mm_loadu_ps(depth + x);
+            __m128 X = _mm_mul_ps(Z, _mm_loadu_ps(rx + x));
+            __m128 Y = _mm_mul_ps(Z, _mm_loadu_ps(ry + x));
+
+            __m128 xc = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r00, X), _mm_mul_ps(r01, Y)),
+                                   _mm_add_ps(_mm_mul_ps(r02, Z), t0));
+            __m128 yc = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r10, X), _mm_mul_ps(r11, Y)),
+                                   _mm_add_ps(_mm_mul_ps(r12, Z), t1));
+            __m128 zc = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r20, X), _mm_mul_ps(r21, Y)),
+                                   _mm_add_ps(_mm_mul_ps(r22, Z), t2));
+            __m128 iz = _mm_div_ps(one, zc);
+            __m128 px = _mm_mul_ps(xc, iz);
+            __m128 py = _mm_mul_ps(yc, iz);
+
+            __m128 px2 = _mm_mul_ps(px, px), py2 = _mm_mul_ps(py, py);
+            __m128 pxy2 = _mm_mul_ps(two, _mm_mul_ps(px, py));
+            __m128 r2 = _mm_add_ps(px2, py2);
+            __m128 r4 = _mm_mul_ps(r2, r2), r6 = _mm_mul_ps(r4, r2);
+            __m128 radial = _mm_div_ps(
+                    _mm_add_ps(one, _mm_add_ps(_mm_add_ps(_mm_mul_ps(k1, r2), _mm_mul_ps(k2, r4)),
+                                               _mm_mul_ps(k3, r6))),
+                    _mm_add_ps(one, _mm_add_ps(_mm_add_ps(_mm_mul_ps(k4, r2), _mm_mul_ps(k5, r4)),
+                                               _mm_mul_ps(k6, r6))));
+            __m128 xd = _mm_add_ps(_mm_mul_ps(px, radial),
+                                   _mm_add_ps(_mm_mul_ps(p1, pxy2),
+                                              _mm_mul_ps(p2, _mm_add_ps(r2, _mm_mul_ps(two, px2)))));
+            __m128 yd = _mm_add_ps(_mm_mul_ps(py, radial),
+                                   _mm_add_ps(_mm_mul_ps(p1, _mm_add_ps(r2, _mm_mul_ps(two, py2))),
+                                              _mm_mul_ps(p2, pxy2)));
+            __m128i u = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(fx, xd), cx));
+            __m128i v = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(fy, yd), cy));
+
+            // NaN depth compares false and is dropped with the invalid points.
+            __m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(Z, zero), _mm_cmple_ps(Z, zmax)),
+                                      _mm_and_ps(_mm_cmpgt_ps(zc, zmin), _mm_cmplt_ps(r2, maxr2)));
+            _mm_storeu_ps(zs + x, _mm_and_ps(zc, valid));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(targets + 2 * x),
+                             _mm_unpacklo_epi32(u, v));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(targets + 2 * x + 4),
+                             _mm_unpackhi_epi32(u, v));
+        }
+#endif
+
+        for (; x < cols; x++)
+            project(depth[x] * rx[x], depth[x] * ry[x], depth[x], targets + 2 * x, zs[x]);
+    }
+
+    void project(float X, float Y, float Z, int* target, float& z) const {
+        const cv::Matx33f& R = _R;
+        const float* c = _color;
+        z = 0;
+        target[0] = target[1] = INT_MIN;
+
+        float zc = R(2, 0) * X + R(2, 1) * Y + R(2, 2) * Z + _t[2];
+
+        if (!(Z > 0) || !(Z <= _maxDepth) || !(zc > ZMIN))
+            return;
+
+        float iz = 1.0f / zc;
+        float px = (R(0, 0) * X + R(0, 1) * Y + R(0, 2) * Z + _t[0]) * iz;
+        float py = (R(1, 0) * X + R(1, 1) * Y + R(1, 2) * Z + _t[1]) * iz;
+        float r2 = px * px + py * py;
+
+        if (!(r2 < _maxRadius2))
+            return;
+
+        float r4 = r2 * r2, r6 = r4 * r2;
+        float radial = (1 + c[4] * r2 + c[5] * r4 + c[8] * r6) /
+                       (1 + c[9] * r2 + c[10] * r4 + c[11] * r6);
+        float xd = px * radial + 2 * c[6] * px * py + c[7] * (r2 + 2 * px * px);
+        float yd = py * radial + c[6] * (r2 + 2 * py * py) + 2 * c[7] * px * py;
+        target[0] = cvRound(c[0] * xd + c[2] - _offset);
+        target[1] = cvRound(c[1] * yd + c[3] - _offset);
+        z = zc;
+    }
+};
+
+/**
+ * Build rows of an organized point cloud from the z-buffer.
+ */
+template <typename PointT>
+class CloudBuilder: public cv::ParallelLoopBody {
+public:
+    CloudBuilder(const cv::Mat& zbuffer, const cv::Mat* rays, const cv::Mat& color,
+                 PointT* points) :
+            _zbuffer(zbuffer),
+            _rays(rays),
+            _color(color),
+            _points(points) {
+    }
+
+    void operator()(const cv::Range& range) const {
+        const int cols = _zbuffer.cols;
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+
+        for (int y = range.start; y < range.end; y++) {
+            const float* z = _zbuffer.ptr<float>(y);
+            const float* rx = _rays[0].ptr<float>(y);
+            const float* ry = _rays[1].ptr<float>(y);
+            const cv::Vec3b* color = _color.empty() ? NULL : _color.ptr<cv::Vec3b>(y);
+            PointT* points = _points + (size_t) y * cols;
+
+            for (int x = 0; x < cols; x++) {
+                PointT& point = points[x];
+
+                if (z[x] > 0) {
+                    point.x = rx[x] * z[x];
+                    point.y = ry[x] * z[x];
+                    point.z = z[x];
+                } else {
+                    point.x = point.y = point.z = nan;
+                }
+
+                if (color)
+                    setColor(point, color + x);
+            }
+        }
+    }
+
+private:
+    const cv::Mat& _zbuffer;
+
+    const cv::Mat* _rays;
+
+    const cv::Mat& _color;
+
+    PointT* _points;
+};
+
+template <typename PointT>
+void buildCloud(const cv::Mat& zbuffer, const cv::Mat* rays, const cv::Mat& color,
+                pcl::PointCloud<PointT>& cloud) {
+    cloud.points.resize(zbuffer.total());
+    cloud.width = zbuffer.cols;
+    cloud.height = zbuffer.rows;
+    cloud.is_dense = false;
+
+    cv::parallel_for_(cv::Range(0, zbuffer.rows),
+                      CloudBuilder<PointT>(zbuffer, rays, color, cloud.points.data()));
+}
+
+}
+
+DepthRegistrator::DepthRegistrator(std::shared_ptr<DepthCamera> camera, const std::string& params,
+                                   float depthUnit, float translationUnit, float maxDepth) :
+        DepthCalibrator(camera),
+        _csize(camera->colorSize()),
+        _dsize(camera->depthSize()),
+        _depthUnit(depthUnit),
+        _maxDepth(maxDepth * depthUnit),
+        _maxRadius2(0),
+        _splat(1) {
+    loadParameters(params, translationUnit);
+}
+
+DepthRegistrator::~DepthRegistrator() {
+}
+
+cv::Size DepthRegistrator::depthSize() const {
+    return _csize;
+}
+
+void DepthRegistrator::captureColor(cv::Mat& buffer) {
+    _camera->captureColor(buffer);
+}
+
+Frame::Ptr DepthRegistrator::acquireColorFrame() {
+    return _camera->acquireColorFrame();
+}
+
+void DepthRegistrator::captureDepth(cv::Mat& buffer) {
+    Frame::Ptr depth = _camera->acquireDepthFrame();
+
+    if (depth)
+        registerDepth(depth->data, buffer);
+}
+
+Frame::Ptr DepthRegistrator::acquireDepthFrame() {
+    Frame::Ptr depth = _camera->acquireDepthFrame();
+
+    if (!depth)
+        return depth;
+
+    std::shared_ptr<Frame> frame;
+
+    {
+        boost::mutex::scoped_lock lock(_framesMutex);
+        frame = _frames.allocate(_csize, depth->data.type());
+    }
+
+    frame->info = depth->info;
+    registerDepth(depth->data, frame->data);
+
+    return frame;
+}
+
+void DepthRegistrator::capturePointCloud(PointCloud::Ptr buffer) {
+    Frame::Ptr depth = _camera->acquireDepthFrame();
+
+    if (!depth)
+        return;
+
+    boost::mutex::scoped_lock lock(_mutex);
+    buildZBuffer(depth->data);
+    stampHeader(buffer->header, depth->info);
+    buildCloud(_zbuffer, _colorRays, cv::Mat(), *buffer);
+}
+
+void DepthRegistrator::captureColoredPointCloud(ColoredPointCloud::Ptr buffer) {
+    Frame::Ptr color = _camera->acquireColorFrame();
+    Frame::Ptr depth = _camera->acquireDepthFrame();
+
+    if (!color || !depth || color->data.size() != _csize)
+        return;
+
+    boost::mutex::scoped_lock lock(_mutex);
+    buildZBuffer(depth->data);
+    stampHeader(buffer->header, depth->info);
+    buildCloud(_zbuffer, _colorRays, color->data, *buffer);
+}
+
+void DepthRegistrator::registerDepth(const cv::Mat& depth, cv::Mat& registered) {
+    static Histogram& process = Metrics::instance().histogram("depth_registrator.depth.process");
+    static Histogram& lockWait = Metrics::instance().histogram("depth_registrator.depth.lock_wait");
+    const uint64_t start = Metrics::now();
+    boost::mutex::scoped_lock lock(_mutex);
+    lockWait.record(Metrics::now() - start);
+
+    ScopedTimer timer(process);
+    buildZBuffer(depth);
+    _zbuffer.convertTo(registered, depth.type(), 1.0 / _depthUnit);
+}
+
+void DepthRegistrator::loadParameters(const std::string& params, float translationUnit) {
+    cv::FileStorage fs(params, CV_STORAGE_READ);
+
+    if (!fs.isOpened()) {
+        std::cerr << "DepthRegistrator: cannot open " << params << std::endl;
+        std::exit(-1);
+    }
+
+    cv::Mat M1, D1, M2, D2, R, T;
+    fs["M1"] >> M1;
+    fs["D1"] >> D1;
+    fs["M2"] >> M2;
+    fs["D2"] >> D2;
+    fs["R"] >> R;
+    fs["T"] >> T;
+    fs.release();
+
+    if (M1.empty() || D1.empty() || M2.empty() || D2.empty() || R.empty() || T.empty()) {
+        std::cerr << "DepthRegistrator: no stereo parameters in " << params << std::endl;
+        std::exit(-1);
+    }
+
+    M1.convertTo(M1, CV_64F);
+    D1.convertTo(D1, CV_64F);
+
+    // Parameters calibrated at another color resolution put the principal
+    // point far from the center of the image.
+    if (std::abs(M1.at<double>(0, 2) - (_csize.width - 1) * 0.5) > _csize.width * 0.25 ||
+        std::abs(M1.at<double>(1, 2) - (_csize.height - 1) * 0.5) > _csize.height * 0.25) {
+        std::cerr << "DepthRegistrator: M1 in " << params << " does not fit "
+                  << _csize.width << "x" << _csize.height << " color" << std::endl;
+        std::exit(-1);
+    }
+    R.convertTo(R, CV_64F);
+    T.convertTo(T, CV_64F);
+
+    // R and T map the color camera to the depth camera, so the depth camera
+    // is mapped back by the transposed rotation.
+    for (int i = 0; i < 3; i++) {
+        _translation[i] = 0;
+
+        for (int j = 0; j < 3; j++) {
+            _rotation(i, j) = R.at<double>(j, i);
+            _translation[i] -= R.at<double>(j, i) * T.ptr<double>()[j] * translationUnit;
+        }
+    }
+
+    _color[0] = M1.at<double>(0, 0);
+    _color[1] = M1.at<double>(1, 1);
+    _color[2] = M1.at<double>(0, 2);
+    _color[3] = M1.at<double>(1, 2);
+
+    for (int i = 0; i < 8; i++)
+        _color[4 + i] = i < (int) D1.total() ? D1.ptr<double>()[i] : 0;
+
+    computeRays(M2, D2, _dsize, _depthRays);
+    computeRays(M1, D1, _csize, _colorRays);
+
+    // The image corners are the farthest pixels from the principal point,
+    // with a margin for the squares straddling the border.
+    const int corners[4][2] = { { 0, 0 }, { _csize.width - 1, 0 },
+                                { 0, _csize.height - 1 }, { _csize.width - 1, _csize.height - 1 } };
+
+    for (int i = 0; i < 4; i++) {
+        float rx = _colorRays[0].at<float>(corners[i][1], corners[i][0]);
+        float ry = _colorRays[1].at<float>(corners[i][1], corners[i][0]);
+        _maxRadius2 = std::max(_maxRadius2, 1.1f * (rx * rx + ry * ry));
+    }
+
+    // A depth pixel covers about as many color pixels as the ratio of the
+    // focal lengths, so smaller squares would leave holes between them.
+    M2.convertTo(M2, CV_64F);
+    _splat = std::max(1, cvCeil(M1.at<double>(0, 0) / M2.at<double>(0, 0)));
+
+    std::cout << "DepthRegistrator: " << _dsize.width << "x" << _dsize.height << " depth to "
+              << _csize.width << "x" << _csize.height << " color with " << _splat << "x"
+              << _splat << " squares" << std::endl;
+}
+
+void DepthRegistrator::buildZBuffer(const cv::Mat& depth) {
+    _zbuffer.create(_csize, CV_32F);
+    _zbuffer.setTo(cv::Scalar(0));
+
+    if (depth.size() != _dsize) {
+        std::cerr << "DepthRegistrator: unexpected depth size" << std::endl;
+        return;
+    }
+
+    depth.convertTo(_meters, CV_32F, _depthUnit);
+    _targets.create(_dsize, CV_32SC2);
+    _zs.create(_dsize, CV_32F);
+
+    cv::parallel_for_(cv::Range(0, _dsize.height),
+                      DepthProjector(_meters, _depthRays, _rotation, _translation, _color,
+                                     _maxRadius2, _maxDepth, (_splat - 1) * 0.5f, _targets, _zs));
+
+    // Squares of neighboring pixels overlap, so they are drawn serially
+    // rather than racing for the same z-buffer entries.
+    const int* targets = _targets.ptr<int>();
+    const float* zs = _zs.ptr<float>();
+    const int size = _dsize.area();
+
+    for (int i = 0; i < size; i++) {
+        const float z = zs[i];
+
+        if (!(z > 0))
+            continue;
+
+        const int x0 = std::max(targets[2 * i], 0);
+        const int y0 = std::max(targets[2 * i + 1], 0);
+        const int x1 = std::min(targets[2 * i] + _splat, _csize.width);
+        const int y1 = std::min(targets[2 * i + 1] + _splat, _csize.height);
+
+        for (int y = y0; y < y1; y++) {
+            float* d = _zbuffer.ptr<float>(y);
+
+            for (int x = x0; x < x1; x++)
+                if (d[x] == 0 || z < d[x])
+                    d[x] = z;
+        }
+    }
+}
+
+}
@@ -5,15 +5,74 @@
  */
 
 #include "rgbd/camera/DepthRotator.h"
+#include "rgbd/camera/Rotate.h"
+#include "rgbd/camera/Metrics.h"
 
 namespace rgbd {
 
+namespace {
+
+/**
+ * Rotate a point cloud about the z axis in place. The rotation by a multiple
+ * of 90 degrees is a swap and sign flip of the x and y axes. Organized clouds
+ * are also reordered like the rotated depth image, through the scratch cloud
+ * for 90 and -90 degrees.
+ */
+template <typename PointT>
+void rotateCloud(pcl::PointCloud<PointT>& cloud, pcl::PointCloud<PointT>& scratch, int angle) {
+    if (angle == 0)
+        return;
+
+    auto rotate = [angle](PointT& p) {
+        float x = p.x;
+
+        if (angle == 90) {
+            p.x = -p.y;
+            p.y = x;
+        } else if (angle == -90) {
+            p.x = p.y;
+            p.y = -x;
+        } else {
+            p.x = -x;
+            p.y = -p.y;
+        }
+    };
+
+    if (!cloud.isOrganized() || angle == 180 || angle == -180) {
+        if (cloud.isOrganized())
+            std::reverse(cloud.points.begin(), cloud.points.end());
+
+        for (auto& p: cloud.points)
+            rotate(p);
+
+        return;
+    }
+
+    const int width = cloud.width;
+    const int height = cloud.height;
+    scratch.points.resize(cloud.points.size());
+    PointT* dst = scratch.points.data();
+
+    // Same mapping as rotateImage(), the rotated cloud has width rows.
+    for (int i = 0; i < width; i++) {
+        for (int j = 0; j < height; j++, dst++) {
+            *dst = angle == 90 ? cloud.points[j * width + width - 1 - i] :
+                                 cloud.points[(height - 1 - j) * width + i];
+            rotate(*dst);
+        }
+    }
+
+    cloud.points.swap(scratch.points);
+    cloud.width = height;
+    cloud.height = width;
+}
+
+}
+
 DepthRotator::DepthRotator(std::shared_ptr<DepthCamera> camera, int angle) :
         ColorRotator(camera, angle),
         DepthCamera(),
-        _camera(camera),
-        _dbuffer(cv::Mat::zeros(camera->depthSize(), CV_16U)),
-        _abuffer(cv::Mat::zeros(camera->depthSize(), CV_16U)) {
+        _camera(camera) {
     if (_angle == 0 || _angle == 180 || _angle == -180) {
         _dsize = camera->depthSize();
     } else if (_angle == 90 || _angle == -90) {
@@ -22,13 +81,6 @@ DepthRotator::DepthRotator(std::shared_ptr<DepthCamera> camera, int angle) :
     } else {
         throw UnsupportedException("Angle must be -90, 0, 90, or 180.");
     }
-
-    double c = std::cos(_angle * M_PI / 180.0);
-    double s = std::sin(_angle * M_PI / 180.0);
-    _rotation << c, -s,  0,  0,
-                 s,  c,  0,  0,
-                 0,  0,  1,  0,
-                 0,  0,  0,  1;
 }
 
 DepthRotator::~DepthRotator() {
@@ -46,6 +98,10 @@ void DepthRotator::start() {
     return ColorRotator::start();
 }
 
+bool DepthRotator::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return _camera->waitForNextFrame(sequence, timeout);
+}
+
 void DepthRotator::captureColor(cv::Mat& buffer) {
     ColorRotator::captureColor(buffer);
 }
@@ -55,18 +111,12 @@ void DepthRotator::captureRawColor(cv::Mat& buffer) {
 }
 
 void DepthRotator::captureDepth(cv::Mat& buffer) {
-    _camera->captureDepth(_dbuffer);
-
-    if (_angle == 0) {
-        _dbuffer.copyTo(buffer);
-    } else if (_angle == 90) {
-        cv::transpose(_dbuffer, buffer);
-        cv::flip(buffer, buffer, 0);
-    } else if (_angle == -90) {
-        cv::transpose(_dbuffer, buffer);
-        cv::flip(buffer, buffer, 1);
-    } else {
-        cv::flip(_dbuffer, buffer, -1);
+    static Histogram& process = Metrics::instance().histogram("rotator.depth.process");
+    Frame::Ptr frame = _camera->acquireDepthFrame();
+
+    if (frame) {
+        ScopedTimer timer(process);
+        rotateImage(frame->data, buffer, _angle);
     }
 }
 
@@ -75,18 +125,12 @@ void DepthRotator::captureRawDepth(cv::Mat& buffer) {
 }
 
 void DepthRotator::captureAmplitude(cv::Mat& buffer) {
-    _camera->captureAmplitude(_abuffer);
-
-    if (_angle == 0) {
-        _abuffer.copyTo(buffer);
-    } else if (_angle == 90) {
-        cv::transpose(_abuffer, buffer);
-        cv::flip(buffer, buffer, 0);
-    } else if (_angle == -90) {
-        cv::transpose(_abuffer, buffer);
-        cv::flip(buffer, buffer, 1);
-    } else {
-        cv::flip(_abuffer, buffer, -1);
+    static Histogram& process = Metrics::instance().histogram("rotator.amplitude.process");
+    Frame::Ptr frame = _camera->acquireAmplitudeFrame();
+
+    if (frame) {
+        ScopedTimer timer(process);
+        rotateImage(frame->data, buffer, _angle);
     }
 }
 
@@ -95,13 +139,11 @@ void DepthRotator::captureRawAmplitude(cv::Mat& buffer) {
 }
 
 void DepthRotator::capturePointCloud(PointCloud::Ptr buffer) {
-    PointCloud temp1, temp2;
-
+    static Histogram& process = Metrics::instance().histogram("rotator.vertex.process");
     _camera->capturePointCloud(buffer);
-    std::copy(buffer->points.begin(), buffer->points.end(),
-              std::back_inserter(temp1.points));
-    pcl::transformPointCloud(temp1, temp2, _rotation);
-    std::copy(temp2.points.begin(), temp2.points.end(), buffer->points.begin());
+
+    ScopedTimer timer(process);
+    rotateCloud(*buffer, _vscratch, _angle);
 }
 
 void DepthRotator::captureRawVertex(PointCloud::Ptr buffer) {
@@ -109,13 +151,11 @@ void DepthRotator::captureRawVertex(PointCloud::Ptr buffer) {
 }
 
 void DepthRotator::captureColoredPointCloud(ColoredPointCloud::Ptr buffer) {
-    ColoredPointCloud temp1, temp2;
-
+    static Histogram& process = Metrics::instance().histogram("rotator.colored_vertex.process");
     _camera->captureColoredPointCloud(buffer);
-    std::copy(buffer->points.begin(), buffer->points.end(),
-              std::back_inserter(temp1.points));
-    pcl::transformPointCloud(temp1, temp2, _rotation);
-    std::copy(temp2.points.begin(), temp2.points.end(), buffer->points.begin());
+
+    ScopedTimer timer(process);
+    rotateCloud(*buffer, _cscratch, _angle);
 }
 
 void DepthRotator::captureRawColoredVertex(ColoredPointCloud::Ptr buffer) {
@@ -0,0 +1,240 @@
+/**
+ * @file DisparityEngine.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <iostream>
+#include "rgbd/camera/DisparityEngine.h"
+
+namespace rgbd {
+
+namespace {
+
+template <typename T>
+void readParam(const cv::FileNode& node, const std::string& name, T& value) {
+    if (!node[name].isNone())
+        node[name] >> value;
+}
+
+void readSGBMParams(const cv::FileNode& node, cv::StereoSGBM& sgbm) {
+    int fullDP = sgbm.fullDP;
+
+    readParam(node, "minDisparity", sgbm.minDisparity);
+    readParam(node, "numberOfDisparities", sgbm.numberOfDisparities);
+    readParam(node, "SADWindowSize", sgbm.SADWindowSize);
+    sgbm.P1 = 8 * 3 * sgbm.SADWindowSize * sgbm.SADWindowSize;
+    sgbm.P2 = 32 * 3 * sgbm.SADWindowSize * sgbm.SADWindowSize;
+    readParam(node, "P1", sgbm.P1);
+    readParam(node, "P2", sgbm.P2);
+    readParam(node, "preFilterCap", sgbm.preFilterCap);
+    readParam(node, "uniquenessRatio", sgbm.uniquenessRatio);
+    readParam(node, "speckleWindowSize", sgbm.speckleWindowSize);
+    readParam(node, "speckleRange", sgbm.speckleRange);
+    readParam(node, "disp12MaxDiff", sgbm.disp12MaxDiff);
+    readParam(node, "fullDP", fullDP);
+    sgbm.fullDP = fullDP != 0;
+}
+
+/**
+ * Copy the parameters only, because the matchers must not share their
+ * internal buffer.
+ */
+void copySGBMParams(const cv::StereoSGBM& from, cv::StereoSGBM& to) {
+    to.minDisparity = from.minDisparity;
+    to.numberOfDisparities = from.numberOfDisparities;
+    to.SADWindowSize = from.SADWindowSize;
+    to.P1 = from.P1;
+    to.P2 = from.P2;
+    to.preFilterCap = from.preFilterCap;
+    to.uniquenessRatio = from.uniquenessRatio;
+    to.speckleWindowSize = from.speckleWindowSize;
+    to.speckleRange = from.speckleRange;
+    to.disp12MaxDiff = from.disp12MaxDiff;
+    to.fullDP = from.fullDP;
+}
+
+class BandMatcher: public cv::ParallelLoopBody {
+public:
+    BandMatcher(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity,
+                std::vector<cv::StereoSGBM>& matchers, std::vector<cv::Mat>& disparities,
+                int overlap) :
+            _left(left),
+            _right(right),
+            _disparity(disparity),
+            _matchers(matchers),
+            _disparities(disparities),
+            _overlap(overlap) {
+    }
+
+    void operator()(const cv::Range& range) const {
+        const int rows = _left.rows;
+        const int bands = (int) _matchers.size();
+
+        for (int i = range.start; i < range.end; i++) {
+            int y0 = rows * i / bands;
+            int y1 = rows * (i + 1) / bands;
+            int top = std::max(0, y0 - _overlap);
+            int bottom = std::min(rows, y1 + _overlap);
+
+            _matchers[i](_left.rowRange(top, bottom), _right.rowRange(top, bottom),
+                         _disparities[i]);
+            cv::Mat band = _disparity.rowRange(y0, y1);
+            _disparities[i].rowRange(y0 - top, y1 - top).copyTo(band);
+        }
+    }
+
+private:
+    const cv::Mat& _left;
+
+    const cv::Mat& _right;
+
+    cv::Mat& _disparity;
+
+    std::vector<cv::StereoSGBM>& _matchers;
+
+    std::vector<cv::Mat>& _disparities;
+
+    const int _overlap;
+};
+
+}
+
+DisparityEngine::~DisparityEngine() {
+}
+
+DisparityEngine::Ptr DisparityEngine::create(const std::string& file) {
+    cv::FileStorage fs(file, CV_STORAGE_READ);
+
+    if (!fs.isOpened()) {
+        std::cerr << "DisparityEngine: cannot open " << file << std::endl;
+        return Ptr();
+    }
+
+    return create(fs.root());
+}
+
+DisparityEngine::Ptr DisparityEngine::create(const cv::FileNode& node) {
+    std::string engine = "sgbm";
+    readParam(node, "engine", engine);
+
+    if (engine == "sgbm")
+        return Ptr(new SGBMEngine(node));
+    else if (engine == "bm")
+        return Ptr(new BMEngine(node));
+    else if (engine == "tiled-sgbm")
+        return Ptr(new TiledSGBMEngine(node));
+
+    std::cerr << "DisparityEngine: unknown engine " << engine << std::endl;
+
+    return Ptr();
+}
+
+SGBMEngine::SGBMEngine() {
+    _sgbm.preFilterCap = 63;
+    _sgbm.SADWindowSize = 3;
+    _sgbm.P1 = 8 * 3 * _sgbm.SADWindowSize * _sgbm.SADWindowSize;
+    _sgbm.P2 = 32 * 3 * _sgbm.SADWindowSize * _sgbm.SADWindowSize;
+    _sgbm.minDisparity = 0;
+    _sgbm.numberOfDisparities = 64;
+    _sgbm.uniquenessRatio = 10;
+    _sgbm.speckleWindowSize = 100;
+    _sgbm.speckleRange = 32;
+    _sgbm.disp12MaxDiff = 1;
+    _sgbm.fullDP = false;
+}
+
+SGBMEngine::SGBMEngine(const cv::FileNode& node) :
+        SGBMEngine() {
+    readSGBMParams(node, _sgbm);
+}
+
+SGBMEngine::~SGBMEngine() {
+}
+
+void SGBMEngine::compute(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity) {
+    _sgbm(left, right, disparity);
+}
+
+int SGBMEngine::minDisparity() const {
+    return _sgbm.minDisparity;
+}
+
+cv::StereoSGBM& SGBMEngine::sgbm() {
+    return _sgbm;
+}
+
+BMEngine::BMEngine() :
+        _bm(cv::StereoBM::BASIC_PRESET, 64, 15) {
+    _bm.state->preFilterCap = 31;
+    _bm.state->textureThreshold = 10;
+    _bm.state->uniquenessRatio = 15;
+    _bm.state->speckleWindowSize = 100;
+    _bm.state->speckleRange = 32;
+    _bm.state->disp12MaxDiff = 1;
+}
+
+BMEngine::BMEngine(const cv::FileNode& node) :
+        BMEngine() {
+    readParam(node, "minDisparity", _bm.state->minDisparity);
+    readParam(node, "numberOfDisparities", _bm.state->numberOfDisparities);
+    readParam(node, "SADWindowSize", _bm.state->SADWindowSize);
+    readParam(node, "preFilterCap", _bm.state->preFilterCap);
+    readParam(node, "textureThreshold", _bm.state->textureThreshold);
+    readParam(node, "uniquenessRatio", _bm.state->uniquenessRatio);
+    readParam(node, "speckleWindowSize", _bm.state->speckleWindowSize);
+    readParam(node, "speckleRange", _bm.state->speckleRange);
+    readParam(node, "disp12MaxDiff", _bm.state->disp12MaxDiff);
+}
+
+BMEngine::~BMEngine() {
+}
+
+void BMEngine::compute(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity) {
+    cv::cvtColor(left, _lgray, CV_BGR2GRAY);
+    cv::cvtColor(right, _rgray, CV_BGR2GRAY);
+    _bm(_lgray, _rgray, disparity, CV_16S);
+}
+
+int BMEngine::minDisparity() const {
+    return _bm.state->minDisparity;
+}
+
+cv::StereoBM& BMEngine::bm() {
+    return _bm;
+}
+
+TiledSGBMEngine::TiledSGBMEngine(int bands, int overlap) :
+        _bands(bands),
+        _overlap(overlap) {
+}
+
+TiledSGBMEngine::TiledSGBMEngine(const cv::FileNode& node) :
+        SGBMEngine(node),
+        _bands(0),
+        _overlap(16) {
+    readParam(node, "bands", _bands);
+    readParam(node, "overlap", _overlap);
+}
+
+TiledSGBMEngine::~TiledSGBMEngine() {
+}
+
+void TiledSGBMEngine::compute(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity) {
+    int bands = _bands > 0 ? _bands : cv::getNumThreads();
+    bands = std::max(1, std::min(bands, left.rows));
+
+    if ((int) _matchers.size() != bands) {
+        _matchers.resize(bands);
+        _disparities.resize(bands);
+    }
+
+    for (auto& matcher: _matchers)
+        copySGBMParams(_sgbm, matcher);
+
+    disparity.create(left.size(), CV_16S);
+    cv::parallel_for_(cv::Range(0, bands),
+                      BandMatcher(left, right, disparity, _matchers, _disparities, _overlap));
+}
+
+}
@@ -5,40 +5,19 @@
  */
 
 #include "rgbd/camera/DistortionCalibrator.h"
+#include "rgbd/camera/Metrics.h"
 
 namespace rgbd {
 
 DistortionCalibrator::DistortionCalibrator(std::shared_ptr<ColorCamera> camera,
                                            const std::string& intrinsics):
         _camera(camera) {
-    cv::Mat cameraMatrix;
-    cv::Mat distCoeffs;
-    cv::FileStorage fs(intrinsics , CV_STORAGE_READ);
-
-    if (fs.isOpened()) {
-        if (!fs["M"].isNone() && !fs["D"].isNone()) {
-            fs["M"] >> cameraMatrix;
-            fs["D"] >> distCoeffs;
-        } else if (!fs["cameraMatrix"].isNone() && !fs["distCoeffs"].isNone()) {
-            fs["cameraMatrix"] >> cameraMatrix;
-            fs["distCoeffs"] >> distCoeffs;
-        }
-
-        std::cerr << "DistortionCalibrator: cameraMatrix = " << std::endl;
-        std::cout << cameraMatrix << std::endl;
-        std::cerr << "DistortionCalibrator: distCoeffs = " << std::endl;
-        std::cout << distCoeffs << std::endl;
-
-        cv::initUndistortRectifyMap(cameraMatrix, distCoeffs, cv::Mat(), cameraMatrix,
-                                    camera->colorSize(), CV_16SC2,
-                                    _rectifyMaps[0], _rectifyMaps[1]);
-
-        std::cout << "DistortionCalibrator: undistorted" << std::endl;
-        fs.release();
-    } else {
-        std::cerr << "DistortionCalibrator: cannot open " << intrinsics << std::endl;
+    if (!_undistorter.load(intrinsics, camera->colorSize())) {
+        std::cerr << "DistortionCalibrator: cannot load " << intrinsics << std::endl;
         std::exit(-1);
     }
+
+    std::cout << "DistortionCalibrator: undistorted" << std::endl;
 }
 
 DistortionCalibrator::~DistortionCalibrator() {
@@ -52,9 +31,46 @@ void DistortionCalibrator::start() {
     _camera->start();
 }
 
+bool DistortionCalibrator::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return _camera->waitForNextFrame(sequence, timeout);
+}
+
+void DistortionCalibrator::setTriggerMode(TriggerMode mode) {
+    _camera->setTriggerMode(mode);
+}
+
+void DistortionCalibrator::trigger() {
+    _camera->trigger();
+}
+
 void DistortionCalibrator::captureColor(cv::Mat& buffer) {
-    _camera->captureColor(buffer);
-    cv::remap(buffer, buffer, _rectifyMaps[0], _rectifyMaps[1], CV_INTER_LINEAR);
+    static Histogram& process = Metrics::instance().histogram("distortion_calibrator.color.process");
+    Frame::Ptr frame = _camera->acquireColorFrame();
+
+    if (frame) {
+        ScopedTimer timer(process);
+        _undistorter.undistort(frame->data, buffer);
+    }
+}
+
+Frame::Ptr DistortionCalibrator::acquireColorFrame() {
+    static Histogram& process = Metrics::instance().histogram("distortion_calibrator.color.process");
+    static Histogram& lockWait = Metrics::instance().histogram("distortion_calibrator.color.lock_wait");
+    Frame::Ptr frame = _camera->acquireColorFrame();
+
+    if (!frame)
+        return frame;
+
+    const uint64_t start = Metrics::now();
+    boost::mutex::scoped_lock lock(_mutex);
+    lockWait.record(Metrics::now() - start);
+
+    ScopedTimer timer(process);
+    std::shared_ptr<Frame> undistorted = _frames.allocate(frame->data.size(), frame->data.type());
+    _undistorter.undistort(frame->data, undistorted->data);
+    undistorted->info = frame->info;
+
+    return undistorted;
 }
 
 void DistortionCalibrator::captureRawColor(cv::Mat& buffer) {
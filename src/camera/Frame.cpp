@@ -0,0 +1,146 @@
+/**
+ * @file Frame.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <chrono>
+#include "rgbd/camera/Frame.h"
+#include "rgbd/camera/BufferPool.h"
+#include "rgbd/camera/Metrics.h"
+
+namespace rgbd {
+
+FrameInfo::FrameInfo() :
+        deviceTime(0),
+        hostTime(0),
+        sequence(0),
+        dropped(0) {
+}
+
+uint64_t FrameInfo::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Frame::Frame() {
+    data.allocator = &BufferPool::instance();
+}
+
+Frame::Frame(const cv::Size& size, int type) {
+    data.allocator = &BufferPool::instance();
+    data.create(size, type);
+}
+
+FramePool::FramePool(size_t reserved) :
+        _sequence(0),
+        _consumed(0),
+        _produced(NULL),
+        _consumedFrames(NULL),
+        _dropped(NULL),
+        _interval(NULL),
+        _lockWait(NULL),
+        _published(0) {
+    _frames.reserve(reserved);
+}
+
+FramePool::~FramePool() {
+}
+
+std::shared_ptr<Frame> FramePool::allocate(const cv::Size& size, int type) {
+    // A frame only referenced by the pool cannot be reached by any consumer,
+    // because the latest one is also held by _latest.
+    for (auto& frame: _frames) {
+        if (frame.use_count() == 1) {
+            frame->data.create(size, type);
+            return frame;
+        }
+    }
+
+    std::shared_ptr<Frame> frame(new Frame(size, type));
+    _frames.push_back(frame);
+
+    return frame;
+}
+
+std::shared_ptr<Frame> FramePool::allocate() {
+    for (auto& frame: _frames)
+        if (frame.use_count() == 1)
+            return frame;
+
+    std::shared_ptr<Frame> frame(new Frame());
+    _frames.push_back(frame);
+
+    return frame;
+}
+
+size_t FramePool::frames() const {
+    return _frames.size();
+}
+
+void FramePool::publish(const std::shared_ptr<Frame>& frame) {
+    frame->info.sequence = ++_sequence;
+    const uint64_t start = _lockWait ? Metrics::now() : 0;
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+
+        if (_lockWait) {
+            const uint64_t now = Metrics::now();
+            _lockWait->record(now - start);
+            _produced->add();
+
+            if (_published > 0)
+                _interval->record(now - _published);
+            if (_latest && _latest->info.sequence > _consumed)
+                _dropped->add();
+
+            _published = now;
+        }
+
+        _latest = frame;
+    }
+
+    _condition.notify_all();
+}
+
+Frame::Ptr FramePool::latest() const {
+    const uint64_t start = _lockWait ? Metrics::now() : 0;
+    boost::mutex::scoped_lock lock(_mutex);
+
+    if (_lockWait) {
+        _lockWait->record(Metrics::now() - start);
+
+        if (_latest && _latest->info.sequence > _consumed)
+            _consumedFrames->add();
+    }
+
+    if (_latest)
+        _consumed = _latest->info.sequence;
+
+    return _latest;
+}
+
+bool FramePool::waitForNext(uint64_t& sequence, int timeout) const {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    if (!_condition.timed_wait(lock, boost::posix_time::milliseconds(timeout), [this, sequence] {
+        return _latest && _latest->info.sequence > sequence;
+    }))
+        return false;
+
+    sequence = _latest->info.sequence;
+
+    return true;
+}
+
+void FramePool::instrument(const std::string& name) {
+    Metrics& metrics = Metrics::instance();
+    _produced = &metrics.counter(name + ".produced");
+    _consumedFrames = &metrics.counter(name + ".consumed");
+    _dropped = &metrics.counter(name + ".dropped");
+    _interval = &metrics.histogram(name + ".interval");
+    _lockWait = &metrics.histogram(name + ".lock_wait");
+}
+
+}
@@ -0,0 +1,289 @@
+/**
+ * @file Metrics.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <fstream>
+#include <boost/bind.hpp>
+#include "rgbd/camera/Metrics.h"
+
+namespace rgbd {
+
+Histogram::Histogram() {
+    reset();
+}
+
+void Histogram::record(uint64_t ns) {
+    _buckets[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(ns, std::memory_order_relaxed);
+
+    uint64_t current = _max.load(std::memory_order_relaxed);
+
+    while (ns > current && !_max.compare_exchange_weak(current, ns, std::memory_order_relaxed))
+        ;
+}
+
+uint64_t Histogram::count() const {
+    return _count.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::sum() const {
+    return _sum.load(std::memory_order_relaxed);
+}
+
+uint64_t Histogram::max() const {
+    return _max.load(std::memory_order_relaxed);
+}
+
+double Histogram::mean() const {
+    const uint64_t n = count();
+
+    return n > 0 ? (double) sum() / n : 0.0;
+}
+
+uint64_t Histogram::percentile(double fraction) const {
+    uint64_t counts[BUCKETS];
+    uint64_t total = 0;
+
+    // Buckets may be recorded into meanwhile, so the total is taken from
+    // the same snapshot.
+    for (int i = 0; i < BUCKETS; i++) {
+        counts[i] = _buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    if (total == 0)
+        return 0;
+
+    const uint64_t rank = std::max<uint64_t>((uint64_t) std::ceil(fraction * total), 1);
+    uint64_t seen = 0;
+
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += counts[i];
+
+        if (seen >= rank)
+            return std::min(upperBound(i), max());
+    }
+
+    return max();
+}
+
+void Histogram::reset() {
+    for (auto& bucket: _buckets)
+        bucket.store(0, std::memory_order_relaxed);
+
+    _count.store(0, std::memory_order_relaxed);
+    _sum.store(0, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+}
+
+int Histogram::bucket(uint64_t ns) {
+    if (ns < 4)
+        return (int) ns;
+
+    // The highest bit selects the power of two and the next two bits
+    // select the quarter of it.
+    const int msb = 63 - __builtin_clzll(ns);
+
+    return (msb - 1) * 4 + (int) ((ns >> (msb - 2)) & 3);
+}
+
+uint64_t Histogram::upperBound(int bucket) {
+    if (bucket < 4)
+        return bucket;
+
+    const int shift = bucket / 4 - 1;
+
+    return ((uint64_t) (4 + bucket % 4) << shift) + ((uint64_t) 1 << shift) - 1;
+}
+
+Counter::Counter() :
+        _value(0) {
+}
+
+void Counter::add(uint64_t n) {
+    _value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Counter::value() const {
+    return _value.load(std::memory_order_relaxed);
+}
+
+void Counter::reset() {
+    _value.store(0, std::memory_order_relaxed);
+}
+
+Metrics::Metrics() :
+        _dumping(false) {
+}
+
+Metrics::~Metrics() {
+    stopDump();
+}
+
+Metrics& Metrics::instance() {
+    // Never destroyed, since device threads may record until the very end.
+    static Metrics* metrics = new Metrics();
+
+    return *metrics;
+}
+
+uint64_t Metrics::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Histogram& Metrics::histogram(const std::string& name) {
+    boost::mutex::scoped_lock lock(_mutex);
+    std::unique_ptr<Histogram>& histogram = _histograms[name];
+
+    if (!histogram)
+        histogram.reset(new Histogram());
+
+    return *histogram;
+}
+
+Counter& Metrics::counter(const std::string& name) {
+    boost::mutex::scoped_lock lock(_mutex);
+    std::unique_ptr<Counter>& counter = _counters[name];
+
+    if (!counter)
+        counter.reset(new Counter());
+
+    return *counter;
+}
+
+void Metrics::write(std::ostream& out, Format format) const {
+    boost::mutex::scoped_lock lock(_mutex);
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+
+    if (format == TEXT) {
+        out << std::left << std::setw(40) << "histogram [us]" << std::right
+            << std::setw(10) << "count" << std::setw(10) << "mean" << std::setw(10) << "p50"
+            << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max"
+            << std::endl << std::fixed << std::setprecision(1);
+
+        for (const auto& it: _histograms) {
+            const Histogram& h = *it.second;
+            out << std::left << std::setw(40) << it.first << std::right
+                << std::setw(10) << h.count() << std::setw(10) << h.mean() / 1.0e3
+                << std::setw(10) << h.percentile(0.5) / 1.0e3
+                << std::setw(10) << h.percentile(0.9) / 1.0e3
+                << std::setw(10) << h.percentile(0.99) / 1.0e3
+                << std::setw(10) << h.max() / 1.0e3 << std::endl;
+        }
+
+        out << std::endl << std::left << std::setw(40) << "counter" << std::right
+            << std::setw(10) << "value" << std::endl;
+
+        for (const auto& it: _counters)
+            out << std::left << std::setw(40) << it.first << std::right
+                << std::setw(10) << it.second->value() << std::endl;
+
+        out.flags(flags);
+        out.precision(precision);
+        return;
+    }
+
+    out << "{\n  \"time_ns\": " << now() << ",\n  \"histograms\": {";
+
+    for (auto it = _histograms.begin(); it != _histograms.end(); ++it) {
+        const Histogram& h = *it->second;
+        out << (it == _histograms.begin() ? "\n" : ",\n")
+            << "    \"" << it->first << "\": { \"count\": " << h.count()
+            << ", \"mean_ns\": " << (uint64_t) h.mean()
+            << ", \"p50_ns\": " << h.percentile(0.5)
+            << ", \"p90_ns\": " << h.percentile(0.9)
+            << ", \"p99_ns\": " << h.percentile(0.99)
+            << ", \"max_ns\": " << h.max() << " }";
+    }
+
+    out << "\n  },\n  \"counters\": {";
+
+    for (auto it = _counters.begin(); it != _counters.end(); ++it)
+        out << (it == _counters.begin() ? "\n" : ",\n")
+            << "    \"" << it->first << "\": " << it->second->value();
+
+    out << "\n  }\n}\n";
+}
+
+bool Metrics::write(const std::string& file, Format format) const {
+    const std::string temporary = file + ".tmp";
+
+    {
+        std::ofstream out(temporary.c_str());
+
+        if (!out)
+            return false;
+
+        write(out, format);
+
+        if (!out)
+            return false;
+    }
+
+    return std::rename(temporary.c_str(), file.c_str()) == 0;
+}
+
+void Metrics::startDump(const std::string& file, int period, Format format) {
+    stopDump();
+
+    _dumping = true;
+    _dumper = boost::thread(boost::bind(&Metrics::dump, this, file, period, format));
+}
+
+void Metrics::stopDump() {
+    {
+        boost::mutex::scoped_lock lock(_dumpMutex);
+        _dumping = false;
+    }
+
+    _dumpCondition.notify_all();
+
+    if (_dumper.joinable())
+        _dumper.join();
+}
+
+void Metrics::reset() {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    for (const auto& it: _histograms)
+        it.second->reset();
+
+    for (const auto& it: _counters)
+        it.second->reset();
+}
+
+void Metrics::dump(std::string file, int period, Format format) {
+    boost::mutex::scoped_lock lock(_dumpMutex);
+
+    // Written once more when stopped, so that the file ends up complete.
+    while (_dumping) {
+        _dumpCondition.timed_wait(lock, boost::posix_time::milliseconds(period), [this] {
+            return !_dumping;
+        });
+
+        if (!write(file, format))
+            std::cerr << "Metrics: cannot write " << file << std::endl;
+    }
+}
+
+ScopedTimer::ScopedTimer(Histogram& histogram) :
+        _histogram(histogram),
+        _start(Metrics::now()) {
+}
+
+ScopedTimer::~ScopedTimer() {
+    _histogram.record(Metrics::now() - _start);
+}
+
+}
@@ -3,26 +3,43 @@
  * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
  * @date Jul 9, 2013
  */
+#include <atomic>
 #include "rgbd/camera/PMDNano.h"
 
 namespace rgbd {
 
+namespace {
+
+/**
+ * Number of cameras opened so far, which tells the metrics of each apart
+ * as the SDK gives no device number.
+ */
+std::atomic<uint> opened(0);
+
+}
+
 PMDNano::PMDNano(const std::string& srcPlugin, const std::string& procPlugin,
                  const std::string& srcParam, const std::string& procParam) :
         DepthCamera(),
-        _running(false) {
+        _running(false),
+        _source(NULL) {
+    const std::string name = "pmd." + std::to_string(opened++);
+    _copy = &Metrics::instance().histogram(name + ".depth.copy");
+    _dframes.instrument(name + ".depth");
+    _aframes.instrument(name + ".amplitude");
+    _vframes.instrument(name + ".vertex");
     open(srcPlugin, procPlugin, srcParam, procParam);
 
     std::cout << "PMDNano: opened" << std::endl;
 }
 
 PMDNano::~PMDNano() {
-    boost::mutex::scoped_lock lock(_mutex);
-
     _running = false;
+
+    if (_thread.joinable())
+        _thread.join();
+
     delete[] _source;
-    delete[] _buffer;
-    delete[] _vbuffer;
     pmdClose(_handle);
 
     std::cout << "PMDNano: closed" << std::endl;
@@ -33,9 +50,6 @@ cv::Size PMDNano::depthSize() const {
 }
 
 void PMDNano::start() {
-    _running = true;
-    boost::thread thread(boost::bind(&PMDNano::update, this));
-
     if (pmdGetSourceDataDescription(_handle, &_description) != PMD_OK)
         closeByError("pmdGetSourceDataDescription");
     if (_description.subHeaderType != PMD_IMAGE_DATA) {
@@ -48,55 +62,97 @@ void PMDNano::start() {
     _height = _description.img.numRows;
     _size = _width * _height;
     _source = new char[_description.size];
-    _buffer = new float[_size];
-    _vbuffer = new float[3 * _size];
 
     if (pmdGetSourceData(_handle, _source, _description.size) != PMD_OK)
         closeByError("pmdGetSourceData");
+
+    // The frame size must be known before the thread starts.
+    _running = true;
+    _thread = boost::thread(boost::bind(&PMDNano::update, this));
+}
+
+bool PMDNano::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return _dframes.waitForNext(sequence, timeout);
 }
 
 void PMDNano::update() {
+    // pmdUpdate() blocks until the next frame, so the loop runs at the device rate.
     while (_running) {
-        {
-            boost::mutex::scoped_lock lock(_mutex);
+        if (pmdUpdate(_handle) != PMD_OK)
+            closeByError("pmdUpdate");
+
+        FrameInfo info;
+        info.hostTime = FrameInfo::now();
+
+        if (pmdGetSourceDataDescription(_handle, &_description) != PMD_OK)
+            closeByError("pmdGetSourceDataDescription");
+
+        info.deviceTime = (uint64_t) _description.timeStampHi << 32 |
+                _description.timeStampLo;
 
-            if (pmdUpdate(_handle) != PMD_OK)
-                closeByError("pmdUpdate");
+        // Fill back frames from the SDK once per update and publish them,
+        // so that captures only read published frames.
+        std::shared_ptr<Frame> depth = _dframes.allocate(depthSize(), CV_32F);
+        std::shared_ptr<Frame> amplitude = _aframes.allocate(depthSize(), CV_32F);
+        std::shared_ptr<Frame> vertex = _vframes.allocate(depthSize(), CV_32FC3);
+
+        {
+            ScopedTimer timer(*_copy);
+
+            if (pmdGetDistances(_handle, depth->data.ptr<float>(), _size * sizeof (float)))
+                closeByError("pmdGetDistances");
+            if (pmdGetAmplitudes(_handle, amplitude->data.ptr<float>(), _size * sizeof (float)))
+                closeByError("pmdGetAmplitudes");
+            if (pmdGet3DCoordinates(_handle, vertex->data.ptr<float>(), 3 * _size * sizeof (float)))
+                closeByError("pmdGet3DCoordinates");
         }
-        usleep(11111); // 90[Hz]
+
+        depth->info = info;
+        amplitude->info = info;
+        vertex->info = info;
+        _vframes.publish(vertex);
+        _aframes.publish(amplitude);
+        _dframes.publish(depth);
     }
 }
 
 void PMDNano::captureDepth(cv::Mat& buffer) {
-    boost::mutex::scoped_lock lock(_mutex);
+    Frame::Ptr frame = _dframes.latest();
 
-    if (pmdGetDistances(_handle, _buffer, _size * sizeof (float)))
-        closeByError("pmdGetDistances");
+    if (frame)
+        frame->data.copyTo(buffer);
+}
 
-    std::memcpy(buffer.data, _buffer, _size * sizeof (float));
+Frame::Ptr PMDNano::acquireDepthFrame() {
+    return _dframes.latest();
 }
 
 void PMDNano::captureAmplitude(cv::Mat& buffer) {
-    boost::mutex::scoped_lock lock(_mutex);
+    Frame::Ptr frame = _aframes.latest();
 
-    if (pmdGetAmplitudes(_handle, _buffer, _size * sizeof (float)))
-        closeByError("pmdGetAmplitudes");
+    if (frame)
+        frame->data.copyTo(buffer);
+}
 
-    std::memcpy(buffer.data, _buffer, _size * sizeof (float));
+Frame::Ptr PMDNano::acquireAmplitudeFrame() {
+    return _aframes.latest();
 }
 
 void PMDNano::capturePointCloud(PointCloud::Ptr buffer) {
-    boost::mutex::scoped_lock lock(_mutex);
-    size_t index = 0;
+    Frame::Ptr frame = _vframes.latest();
+
+    if (!frame)
+        return;
 
-    if (pmdGet3DCoordinates(_handle, _vbuffer, 3 * _size * sizeof (float)))
-        closeByError("pmdGet3DCoordinates");
+    const float* vertex = frame->data.ptr<float>();
+    size_t size = std::min(buffer->points.size(), _size);
+    stampHeader(buffer->header, frame->info);
 
-    for (auto& point: buffer->points) {
-        point.x = _vbuffer[3 * index];
-        point.y = _vbuffer[3 * index + 1];
-        point.z = _vbuffer[3 * index + 2];
-        index++;
+    for (size_t index = 0; index < size; index++) {
+        auto& point = buffer->points[index];
+        point.x = vertex[3 * index];
+        point.y = vertex[3 * index + 1];
+        point.z = vertex[3 * index + 2];
     }
 }
 
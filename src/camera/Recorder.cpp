@@ -0,0 +1,201 @@
+/**
+ * @file Recorder.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <cstring>
+#include <boost/bind.hpp>
+#include "rgbd/camera/Recorder.h"
+
+namespace rgbd {
+
+using namespace record;
+
+namespace {
+
+const char PADDING[RECORD_ALIGNMENT] = { 0 };
+
+size_t padding(size_t size) {
+    return (RECORD_ALIGNMENT - size % RECORD_ALIGNMENT) % RECORD_ALIGNMENT;
+}
+
+}
+
+Recorder::Recorder(std::shared_ptr<ColorCamera> camera, const std::string& file, int streams) :
+        _camera(camera),
+        _depth(std::dynamic_pointer_cast<DepthCamera>(camera)),
+        _streams(streams),
+        _out(file.c_str(), std::ios::binary | std::ios::trunc),
+        _running(false) {
+    if (!_out) {
+        std::cerr << "Recorder: cannot open " << file << std::endl;
+        std::exit(-1);
+    }
+
+    if (!_depth && (_streams & ~(1 << COLOR))) {
+        std::cerr << "Recorder: only the color of a color camera can be recorded" << std::endl;
+        std::exit(-1);
+    }
+
+    std::memset(_last, 0, sizeof (_last));
+
+    if (_streams & (1 << POINT_CLOUD))
+        _cloud.reset(new PointCloud(_depth->depthSize().width, _depth->depthSize().height));
+    if (_streams & (1 << COLORED_POINT_CLOUD))
+        _colored.reset(new ColoredPointCloud(_depth->depthSize().width,
+                                             _depth->depthSize().height));
+
+    RecordHeader header;
+    std::memset(&header, 0, sizeof (header));
+    std::memcpy(header.magic, RECORD_MAGIC, sizeof (RECORD_MAGIC));
+    header.version = 1;
+    _out.write(reinterpret_cast<const char*>(&header), sizeof (header));
+
+    std::cout << "Recorder: recording to " << file << std::endl;
+}
+
+Recorder::~Recorder() {
+    stop();
+    close();
+}
+
+void Recorder::start() {
+    _running = true;
+    _thread = boost::thread(boost::bind(&Recorder::update, this));
+}
+
+void Recorder::stop() {
+    _running = false;
+
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void Recorder::record() {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    if (_streams & (1 << COLOR))
+        writeFrame(COLOR, _camera->acquireColorFrame());
+    if (_streams & (1 << DEPTH))
+        writeFrame(DEPTH, _depth->acquireDepthFrame());
+    if (_streams & (1 << AMPLITUDE))
+        writeFrame(AMPLITUDE, _depth->acquireAmplitudeFrame());
+
+    if (_streams & (1 << POINT_CLOUD)) {
+        _depth->capturePointCloud(_cloud);
+        _points.create(_cloud->height, _cloud->width, CV_32FC3);
+        cv::Point3f* p = _points.ptr<cv::Point3f>();
+
+        for (const auto& point: _cloud->points)
+            *p++ = cv::Point3f(point.x, point.y, point.z);
+
+        FrameInfo info;
+        info.hostTime = _cloud->header.stamp;
+        info.sequence = _cloud->header.seq;
+        write(POINT_CLOUD, _points, info);
+    }
+
+    if (_streams & (1 << COLORED_POINT_CLOUD)) {
+        _depth->captureColoredPointCloud(_colored);
+        _points.create(_colored->height, _colored->width, CV_32FC4);
+        float* p = _points.ptr<float>();
+
+        for (const auto& point: _colored->points) {
+            *p++ = point.x;
+            *p++ = point.y;
+            *p++ = point.z;
+            *p++ = point.rgb;
+        }
+
+        FrameInfo info;
+        info.hostTime = _colored->header.stamp;
+        info.sequence = _colored->header.seq;
+        write(COLORED_POINT_CLOUD, _points, info);
+    }
+}
+
+uint64_t Recorder::recorded() const {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    return _index.size();
+}
+
+void Recorder::update() {
+    uint64_t sequence = 0;
+
+    while (_running) {
+        if (_camera->waitForNextFrame(sequence, 100))
+            record();
+    }
+}
+
+void Recorder::writeFrame(Stream stream, const Frame::Ptr& frame) {
+    if (frame)
+        write(stream, frame->data, frame->info);
+}
+
+void Recorder::write(Stream stream, const cv::Mat& data, const FrameInfo& info) {
+    if (data.empty())
+        return;
+
+    // A frame is recorded once however many times it is seen. Frames
+    // without a host time cannot be told apart, so all of them are recorded.
+    if (info.hostTime != 0 && info.hostTime == _last[stream][0] &&
+        info.sequence == _last[stream][1])
+        return;
+
+    _last[stream][0] = info.hostTime;
+    _last[stream][1] = info.sequence;
+
+    const size_t row = data.cols * data.elemSize();
+    ChunkHeader header;
+    std::memset(&header, 0, sizeof (header));
+    header.magic = CHUNK_MAGIC;
+    header.stream = stream;
+    header.rows = data.rows;
+    header.cols = data.cols;
+    header.type = data.type();
+    header.deviceTime = info.deviceTime;
+    header.hostTime = info.hostTime != 0 ? info.hostTime : FrameInfo::now();
+    header.sequence = info.sequence;
+    header.dropped = info.dropped;
+    header.size = row * data.rows + padding(row * data.rows);
+
+    _index.push_back(_out.tellp());
+    _out.write(reinterpret_cast<const char*>(&header), sizeof (header));
+
+    if (data.isContinuous()) {
+        _out.write(reinterpret_cast<const char*>(data.data), row * data.rows);
+    } else {
+        for (int y = 0; y < data.rows; y++)
+            _out.write(reinterpret_cast<const char*>(data.ptr(y)), row);
+    }
+
+    _out.write(PADDING, padding(row * data.rows));
+
+    if (!_out) {
+        std::cerr << "Recorder: cannot write" << std::endl;
+        std::exit(-1);
+    }
+}
+
+void Recorder::close() {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    if (!_out.is_open())
+        return;
+
+    RecordFooter footer;
+    footer.index = _out.tellp();
+    footer.count = _index.size();
+    std::memcpy(footer.magic, INDEX_MAGIC, sizeof (INDEX_MAGIC));
+
+    _out.write(reinterpret_cast<const char*>(_index.data()), _index.size() * sizeof (uint64_t));
+    _out.write(reinterpret_cast<const char*>(&footer), sizeof (footer));
+    _out.close();
+
+    std::cout << "Recorder: recorded " << footer.count << " frames" << std::endl;
+}
+
+}
@@ -0,0 +1,369 @@
+/**
+ * @file ReplayCamera.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/bind.hpp>
+#include "rgbd/camera/ReplayCamera.h"
+
+namespace rgbd {
+
+using namespace record;
+
+/**
+ * Read-only mapping of a recording, which is unmapped once the camera and
+ * every frame handed out are gone.
+ */
+class ReplayCamera::Mapping {
+public:
+    Mapping(const std::string& file) :
+            data(NULL),
+            size(0) {
+        int fd = ::open(file.c_str(), O_RDONLY);
+
+        if (fd < 0)
+            return;
+
+        struct stat st;
+
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(p);
+                size = st.st_size;
+            }
+        }
+
+        ::close(fd);
+    }
+
+    ~Mapping() {
+        if (data)
+            munmap(const_cast<char*>(data), size);
+    }
+
+    const char* data;
+
+    size_t size;
+};
+
+ReplayCamera::ReplayCamera(const std::string& file, double speed, bool loop) :
+        DepthCamera(),
+        _main(Recorder::COLOR),
+        _speed(speed),
+        _loop(loop),
+        _cursor(0),
+        _published(0),
+        _running(false) {
+    index(file);
+
+    std::cout << "ReplayCamera: opened " << file << " with " << _frames.size() << " frames"
+              << std::endl;
+}
+
+ReplayCamera::~ReplayCamera() {
+    _running = false;
+
+    if (_thread.joinable())
+        _thread.join();
+
+    std::cout << "ReplayCamera: closed" << std::endl;
+}
+
+cv::Size ReplayCamera::colorSize() const {
+    if (!_first[Recorder::COLOR])
+        throw new UnsupportedException("colorSize");
+
+    return _first[Recorder::COLOR]->data.size();
+}
+
+cv::Size ReplayCamera::depthSize() const {
+    for (int stream = Recorder::DEPTH; stream < Recorder::STREAM_COUNT; stream++)
+        if (_first[stream])
+            return _first[stream]->data.size();
+
+    throw new UnsupportedException("depthSize");
+}
+
+void ReplayCamera::start() {
+    if (_speed > 0 && !_running && !_frames.empty()) {
+        _running = true;
+        _thread = boost::thread(boost::bind(&ReplayCamera::update, this));
+    }
+}
+
+bool ReplayCamera::waitForNextFrame(uint64_t& sequence, int timeout) {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    if (_speed > 0) {
+        if (!_condition.timed_wait(lock, boost::posix_time::milliseconds(timeout), [this, sequence] {
+            return _published > sequence;
+        }))
+            return false;
+    } else {
+        while (_published <= sequence) {
+            if (!publish())
+                return false;
+        }
+    }
+
+    sequence = _published;
+
+    return true;
+}
+
+void ReplayCamera::captureColor(cv::Mat& buffer) {
+    Frame::Ptr frame = acquireColorFrame();
+
+    if (frame)
+        frame->data.copyTo(buffer);
+}
+
+Frame::Ptr ReplayCamera::acquireColorFrame() {
+    return latest(Recorder::COLOR, "acquireColorFrame");
+}
+
+void ReplayCamera::captureDepth(cv::Mat& buffer) {
+    Frame::Ptr frame = acquireDepthFrame();
+
+    if (frame)
+        frame->data.copyTo(buffer);
+}
+
+Frame::Ptr ReplayCamera::acquireDepthFrame() {
+    return latest(Recorder::DEPTH, "acquireDepthFrame");
+}
+
+void ReplayCamera::captureAmplitude(cv::Mat& buffer) {
+    Frame::Ptr frame = acquireAmplitudeFrame();
+
+    if (frame)
+        frame->data.copyTo(buffer);
+}
+
+Frame::Ptr ReplayCamera::acquireAmplitudeFrame() {
+    return latest(Recorder::AMPLITUDE, "acquireAmplitudeFrame");
+}
+
+void ReplayCamera::capturePointCloud(PointCloud::Ptr buffer) {
+    Frame::Ptr frame = latest(Recorder::POINT_CLOUD, "capturePointCloud");
+
+    if (!frame)
+        return;
+
+    const cv::Mat& data = frame->data;
+    const cv::Point3f* p = data.ptr<cv::Point3f>();
+    stampHeader(buffer->header, frame->info);
+    buffer->points.resize(data.total());
+    buffer->width = data.cols;
+    buffer->height = data.rows;
+    buffer->is_dense = false;
+
+    for (auto& point: buffer->points) {
+        point.x = p->x;
+        point.y = p->y;
+        point.z = p->z;
+        p++;
+    }
+}
+
+void ReplayCamera::captureColoredPointCloud(ColoredPointCloud::Ptr buffer) {
+    Frame::Ptr frame = latest(Recorder::COLORED_POINT_CLOUD, "captureColoredPointCloud");
+
+    if (!frame)
+        return;
+
+    const cv::Mat& data = frame->data;
+    const float* p = data.ptr<float>();
+    stampHeader(buffer->header, frame->info);
+    buffer->points.resize(data.total());
+    buffer->width = data.cols;
+    buffer->height = data.rows;
+    buffer->is_dense = false;
+
+    for (auto& point: buffer->points) {
+        point.x = p[0];
+        point.y = p[1];
+        point.z = p[2];
+        point.rgb = p[3];
+        p += 4;
+    }
+}
+
+bool ReplayCamera::hasStream(Recorder::Stream stream) const {
+    return (bool) _first[stream];
+}
+
+size_t ReplayCamera::frameCount() const {
+    return _frames.size();
+}
+
+bool ReplayCamera::finished() const {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    return !_loop && _cursor == _frames.size();
+}
+
+void ReplayCamera::index(const std::string& file) {
+    _mapping.reset(new Mapping(file));
+    const char* data = _mapping->data;
+    const size_t size = _mapping->size;
+
+    if (!data || size < sizeof (RecordHeader) ||
+        std::memcmp(data, RECORD_MAGIC, sizeof (RECORD_MAGIC)) != 0) {
+        std::cerr << "ReplayCamera: cannot open " << file << std::endl;
+        std::exit(-1);
+    }
+
+    std::vector<uint64_t> offsets;
+    RecordFooter footer;
+
+    if (size >= sizeof (RecordHeader) + sizeof (footer))
+        std::memcpy(&footer, data + size - sizeof (footer), sizeof (footer));
+
+    if (size >= sizeof (RecordHeader) + sizeof (footer) &&
+        std::memcmp(footer.magic, INDEX_MAGIC, sizeof (INDEX_MAGIC)) == 0 &&
+        footer.index <= size - sizeof (footer) &&
+        footer.count == (size - sizeof (footer) - footer.index) / sizeof (uint64_t) &&
+        (size - sizeof (footer) - footer.index) % sizeof (uint64_t) == 0) {
+        const uint64_t* index = reinterpret_cast<const uint64_t*>(data + footer.index);
+        offsets.assign(index, index + footer.count);
+    } else {
+        // The recording was not closed, so the chunks written in full are
+        // found by walking them from the start.
+        uint64_t offset = sizeof (RecordHeader);
+
+        while (offset + sizeof (ChunkHeader) <= size) {
+            const ChunkHeader* header = reinterpret_cast<const ChunkHeader*>(data + offset);
+
+            // Compared by subtraction, since a broken size may overflow.
+            if (header->magic != CHUNK_MAGIC || header->size > size - offset - sizeof (ChunkHeader))
+                break;
+
+            offsets.push_back(offset);
+            offset += sizeof (ChunkHeader) + header->size;
+        }
+
+        std::cerr << "ReplayCamera: " << file << " is not closed, recovered "
+                  << offsets.size() << " frames" << std::endl;
+    }
+
+    std::shared_ptr<Mapping> mapping = _mapping;
+    _frames.reserve(offsets.size());
+    _streams.reserve(offsets.size());
+
+    for (uint64_t offset: offsets) {
+        const ChunkHeader* header = reinterpret_cast<const ChunkHeader*>(data + offset);
+
+        if (offset > size || size - offset < sizeof (ChunkHeader) ||
+            header->magic != CHUNK_MAGIC || header->stream >= Recorder::STREAM_COUNT ||
+            header->rows < 0 || header->cols < 0 ||
+            (uint64_t) header->rows * header->cols > header->size / CV_ELEM_SIZE(header->type) ||
+            header->size > size - offset - sizeof (ChunkHeader)) {
+            std::cerr << "ReplayCamera: broken frame at " << offset << std::endl;
+            std::exit(-1);
+        }
+
+        // The frame points into the mapping, which it keeps alive.
+        Frame* frame = new Frame();
+        frame->data = cv::Mat(header->rows, header->cols, header->type,
+                              const_cast<char*>(data + offset + sizeof (ChunkHeader)));
+        frame->info.deviceTime = header->deviceTime;
+        frame->info.hostTime = header->hostTime;
+        frame->info.sequence = header->sequence;
+        frame->info.dropped = header->dropped;
+
+        _frames.push_back(Frame::Ptr(frame, [mapping](const Frame* f) {
+            delete f;
+        }));
+        _streams.push_back(header->stream);
+
+        if (!_first[header->stream])
+            _first[header->stream] = _frames.back();
+    }
+
+    if (_first[Recorder::DEPTH]) {
+        _main = Recorder::DEPTH;
+    } else if (!_first[Recorder::COLOR]) {
+        for (int stream = 0; stream < Recorder::STREAM_COUNT; stream++) {
+            if (_first[stream]) {
+                _main = stream;
+                break;
+            }
+        }
+    }
+}
+
+void ReplayCamera::update() {
+    const uint64_t base = _frames.front()->info.hostTime;
+    uint64_t origin = FrameInfo::now();
+
+    while (_running) {
+        size_t cursor;
+
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+
+            if (_cursor == _frames.size()) {
+                if (!_loop)
+                    break;
+
+                _cursor = 0;
+                origin = FrameInfo::now();
+            }
+
+            cursor = _cursor;
+        }
+
+        // Frames of different streams are not recorded in the exact order of
+        // their times, so ones earlier than the first are not delayed.
+        int64_t elapsed = _frames[cursor]->info.hostTime - base;
+        uint64_t due = origin + (uint64_t) (std::max<int64_t>(elapsed, 0) / _speed);
+        uint64_t now = FrameInfo::now();
+
+        if (now < due)
+            boost::this_thread::sleep(boost::posix_time::microseconds(due - now));
+
+        boost::mutex::scoped_lock lock(_mutex);
+        publish();
+    }
+}
+
+bool ReplayCamera::publish() {
+    if (_cursor == _frames.size()) {
+        if (!_loop || _frames.empty())
+            return false;
+
+        _cursor = 0;
+    }
+
+    const int stream = _streams[_cursor];
+    _latest[stream] = _frames[_cursor];
+    _cursor++;
+
+    if (stream == _main)
+        _published++;
+
+    _condition.notify_all();
+
+    return true;
+}
+
+Frame::Ptr ReplayCamera::latest(Recorder::Stream stream, const std::string& function) {
+    if (!_first[stream])
+        throw new UnsupportedException(function);
+
+    boost::mutex::scoped_lock lock(_mutex);
+
+    return _latest[stream];
+}
+
+}
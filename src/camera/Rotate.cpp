@@ -0,0 +1,133 @@
+/**
+ * @file Rotate.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <algorithm>
+#include "rgbd/camera/Rotate.h"
+#include "rgbd/camera/BufferPool.h"
+
+namespace rgbd {
+
+namespace {
+
+/**
+ * Pixel of N bytes, so that each element size needs a single kernel.
+ */
+template <int N>
+struct Pixel {
+    uchar bytes[N];
+};
+
+/**
+ * Rotate by 180 degrees, reading each source row backwards.
+ */
+template <typename T>
+void rotate180(const cv::Mat& src, cv::Mat& dst) {
+    for (int y = 0; y < dst.rows; y++) {
+        const T* s = src.ptr<T>(src.rows - 1 - y) + src.cols - 1;
+        T* d = dst.ptr<T>(y);
+
+        for (int x = 0; x < dst.cols; x++)
+            d[x] = *(s - x);
+    }
+}
+
+/**
+ * Rotate by 90 or -90 degrees over square blocks, so that the source rows
+ * walked by the columns of a block stay in the cache while its destination
+ * rows are written.
+ */
+template <typename T>
+void rotate90(const cv::Mat& src, cv::Mat& dst, bool counterclockwise) {
+    const int block = 64 / sizeof (T) > 8 ? 64 / sizeof (T) : 8;
+    const ptrdiff_t step = counterclockwise ? src.step : -(ptrdiff_t) src.step;
+
+    for (int i0 = 0; i0 < dst.rows; i0 += block) {
+        const int i1 = std::min(i0 + block, dst.rows);
+
+        for (int j0 = 0; j0 < dst.cols; j0 += block) {
+            const int j1 = std::min(j0 + block, dst.cols);
+
+            for (int i = i0; i < i1; i++) {
+                // 90: dst(i, j) = src(j, cols - 1 - i)
+                // -90: dst(i, j) = src(rows - 1 - j, i)
+                const uchar* s = counterclockwise ?
+                        src.ptr<uchar>(j0) + (src.cols - 1 - i) * sizeof (T) :
+                        src.ptr<uchar>(src.rows - 1 - j0) + i * sizeof (T);
+                T* d = dst.ptr<T>(i);
+
+                for (int j = j0; j < j1; j++, s += step)
+                    d[j] = *reinterpret_cast<const T*>(s);
+            }
+        }
+    }
+}
+
+template <typename T>
+void rotate(const cv::Mat& src, cv::Mat& dst, int angle) {
+    if (angle == 90 || angle == -90)
+        rotate90<T>(src, dst, angle == 90);
+    else
+        rotate180<T>(src, dst);
+}
+
+}
+
+void rotateImage(const cv::Mat& src, cv::Mat& dst, int angle) {
+    if (angle == 0) {
+        src.copyTo(dst);
+        return;
+    }
+
+    // Rotating into the source itself would overwrite pixels not read yet.
+    if (src.data == dst.data) {
+        cv::Mat copy;
+        copy.allocator = &BufferPool::instance();
+        src.copyTo(copy);
+        rotateImage(copy, dst, angle);
+        return;
+    }
+
+    if (angle == 90 || angle == -90)
+        dst.create(src.cols, src.rows, src.type());
+    else
+        dst.create(src.rows, src.cols, src.type());
+
+    switch (src.elemSize()) {
+    case 1:
+        rotate<uchar>(src, dst, angle);
+        break;
+    case 2:
+        rotate<ushort>(src, dst, angle);
+        break;
+    case 3:
+        rotate<Pixel<3> >(src, dst, angle);
+        break;
+    case 4:
+        rotate<uint32_t>(src, dst, angle);
+        break;
+    case 6:
+        rotate<Pixel<6> >(src, dst, angle);
+        break;
+    case 8:
+        rotate<uint64_t>(src, dst, angle);
+        break;
+    case 12:
+        rotate<Pixel<12> >(src, dst, angle);
+        break;
+    default:
+        if (angle == 90) {
+            cv::transpose(src, dst);
+            cv::flip(dst, dst, 0);
+        } else if (angle == -90) {
+            cv::transpose(src, dst);
+            cv::flip(dst, dst, 1);
+        } else {
+            cv::flip(src, dst, -1);
+        }
+    }
+}
+
+}
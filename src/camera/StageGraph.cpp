@@ -0,0 +1,342 @@
+/**
+ * @file StageGraph.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <set>
+#include <boost/bind.hpp>
+#include "rgbd/camera/StageGraph.h"
+
+namespace rgbd {
+
+namespace {
+
+const char* const SOURCES[] = { "color", "depth", "amplitude" };
+
+bool isSource(const std::string& name) {
+    for (const char* source: SOURCES)
+        if (name == source)
+            return true;
+
+    return false;
+}
+
+}
+
+Stage::Stage(const std::vector<std::string>& inputs, const std::vector<std::string>& outputs) :
+        _inputs(inputs),
+        _outputs(outputs) {
+    for (size_t i = 0; i < _outputs.size(); i++)
+        _pools.push_back(std::make_shared<FramePool>());
+}
+
+Stage::~Stage() {
+}
+
+const std::vector<std::string>& Stage::inputs() const {
+    return _inputs;
+}
+
+const std::vector<std::string>& Stage::outputs() const {
+    return _outputs;
+}
+
+std::shared_ptr<Frame> Stage::allocate(size_t output, const Frame::Ptr& source,
+                                       const cv::Size& size, int type) {
+    std::shared_ptr<Frame> frame = _pools[output]->allocate(size, type);
+    frame->info = source->info;
+
+    return frame;
+}
+
+/**
+ * Run the stages of a level in parallel.
+ */
+class StageGraph::Runner: public cv::ParallelLoopBody {
+public:
+    Runner(StageGraph& graph, const std::vector<size_t>& level) :
+            _graph(graph),
+            _level(level) {
+    }
+
+    void operator()(const cv::Range& range) const {
+        for (int i = range.start; i < range.end; i++)
+            _graph.runStage(_level[i]);
+    }
+
+private:
+    StageGraph& _graph;
+
+    const std::vector<size_t>& _level;
+};
+
+StageGraph::StageGraph(std::shared_ptr<ColorCamera> camera) :
+        _camera(camera),
+        _depth(std::dynamic_pointer_cast<DepthCamera>(camera)),
+        _scheduled(false),
+        _processed(0),
+        _running(false) {
+    _last[0] = _last[1] = 0;
+}
+
+StageGraph::~StageGraph() {
+    stop();
+}
+
+void StageGraph::add(Stage::Ptr stage) {
+    _stages.push_back(stage);
+    _scheduled = false;
+}
+
+void StageGraph::subscribe(const std::string& name, Callback callback) {
+    _callbacks.insert(std::make_pair(name, callback));
+    _scheduled = false;
+}
+
+void StageGraph::start() {
+    if (_running)
+        return;
+
+    _running = true;
+    _thread = boost::thread(boost::bind(&StageGraph::update, this));
+}
+
+void StageGraph::stop() {
+    _running = false;
+
+    if (_thread.joinable())
+        _thread.join();
+}
+
+bool StageGraph::process() {
+    if (!_scheduled)
+        schedule();
+
+    std::fill(_frames.begin(), _frames.end(), Frame::Ptr());
+
+    auto color = _slots.find("color");
+    auto depth = _slots.find("depth");
+    auto amplitude = _slots.find("amplitude");
+
+    if (color != _slots.end())
+        _frames[color->second] = _camera->acquireColorFrame();
+    if (depth != _slots.end())
+        _frames[depth->second] = _depth->acquireDepthFrame();
+    if (amplitude != _slots.end())
+        _frames[amplitude->second] = _depth->acquireAmplitudeFrame();
+
+    // Depth drives the graph if it is read, and color otherwise.
+    auto main = depth != _slots.end() ? depth : color;
+
+    if (main == _slots.end() || !_frames[main->second])
+        return false;
+
+    const FrameInfo& info = _frames[main->second]->info;
+
+    if (info.hostTime == _last[0] && info.sequence == _last[1])
+        return false;
+
+    _last[0] = info.hostTime;
+    _last[1] = info.sequence;
+
+    for (const auto& level: _levels) {
+        if (level.size() == 1)
+            runStage(level[0]);
+        else
+            cv::parallel_for_(cv::Range(0, level.size()), Runner(*this, level));
+    }
+
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        _latest = _frames;
+        _processed++;
+    }
+
+    _condition.notify_all();
+
+    for (const auto& callback: _callbacks) {
+        const Frame::Ptr& frame = _frames[_slots[callback.first]];
+
+        if (frame)
+            callback.second(frame);
+    }
+
+    return true;
+}
+
+Frame::Ptr StageGraph::latest(const std::string& name) const {
+    boost::mutex::scoped_lock lock(_mutex);
+    auto it = _slots.find(name);
+
+    if (it == _slots.end() || it->second >= _latest.size())
+        return Frame::Ptr();
+
+    return _latest[it->second];
+}
+
+bool StageGraph::waitForNext(uint64_t& sequence, int timeout) {
+    boost::mutex::scoped_lock lock(_mutex);
+
+    if (!_condition.timed_wait(lock, boost::posix_time::milliseconds(timeout), [this, sequence] {
+        return _processed > sequence;
+    }))
+        return false;
+
+    sequence = _processed;
+
+    return true;
+}
+
+void StageGraph::toPointCloud(const Frame::Ptr& frame, PointCloud::Ptr buffer) {
+    const cv::Mat& data = frame->data;
+    const cv::Point3f* p = data.ptr<cv::Point3f>();
+    buffer->header.stamp = frame->info.hostTime;
+    buffer->header.seq = frame->info.sequence;
+    buffer->points.resize(data.total());
+    buffer->width = data.cols;
+    buffer->height = data.rows;
+    buffer->is_dense = false;
+
+    for (auto& point: buffer->points) {
+        point.x = p->x;
+        point.y = p->y;
+        point.z = p->z;
+        p++;
+    }
+}
+
+void StageGraph::schedule() {
+    boost::mutex::scoped_lock lock(_mutex);
+    std::map<std::string, size_t> producers;
+
+    _slots.clear();
+    _levels.clear();
+    _inputSlots.assign(_stages.size(), std::vector<size_t>());
+    _outputSlots.assign(_stages.size(), std::vector<size_t>());
+
+    for (size_t i = 0; i < _stages.size(); i++) {
+        for (const auto& name: _stages[i]->outputs()) {
+            if (isSource(name) || !producers.insert(std::make_pair(name, i)).second) {
+                std::cerr << "StageGraph: " << name << " is produced twice" << std::endl;
+                std::exit(-1);
+            }
+
+            _outputSlots[i].push_back(slot(name));
+        }
+    }
+
+    for (size_t i = 0; i < _stages.size(); i++)
+        for (const auto& name: _stages[i]->inputs())
+            _inputSlots[i].push_back(slot(name));
+
+    for (const auto& callback: _callbacks)
+        slot(callback.first);
+
+    for (const auto& it: _slots) {
+        const std::string& name = it.first;
+
+        if (!isSource(name) && producers.find(name) == producers.end()) {
+            std::cerr << "StageGraph: no stage produces " << name << std::endl;
+            std::exit(-1);
+        }
+
+        if ((name == "depth" || name == "amplitude") && !_depth) {
+            std::cerr << "StageGraph: " << name << " needs a depth camera" << std::endl;
+            std::exit(-1);
+        }
+    }
+
+    // Each level takes the stages whose inputs come from the camera or
+    // from the levels before it.
+    std::vector<bool> done(_stages.size(), false);
+    std::set<std::string> available(SOURCES, SOURCES + 3);
+    size_t remaining = _stages.size();
+
+    while (remaining > 0) {
+        std::vector<size_t> level;
+
+        for (size_t i = 0; i < _stages.size(); i++) {
+            if (done[i])
+                continue;
+
+            bool ready = true;
+
+            for (const auto& name: _stages[i]->inputs())
+                ready = ready && available.count(name) > 0;
+
+            if (ready)
+                level.push_back(i);
+        }
+
+        if (level.empty()) {
+            std::cerr << "StageGraph: stages depend on each other" << std::endl;
+            std::exit(-1);
+        }
+
+        for (size_t i: level) {
+            done[i] = true;
+            available.insert(_stages[i]->outputs().begin(), _stages[i]->outputs().end());
+        }
+
+        remaining -= level.size();
+        _levels.push_back(level);
+    }
+
+    _inputs.assign(_stages.size(), std::vector<Frame::Ptr>());
+    _outputs.assign(_stages.size(), std::vector<Frame::Ptr>());
+
+    for (size_t i = 0; i < _stages.size(); i++) {
+        _inputs[i].resize(_inputSlots[i].size());
+        _outputs[i].resize(_outputSlots[i].size());
+    }
+
+    _frames.assign(_slots.size(), Frame::Ptr());
+    _latest.assign(_slots.size(), Frame::Ptr());
+    _scheduled = true;
+}
+
+size_t StageGraph::slot(const std::string& name) {
+    auto it = _slots.find(name);
+
+    if (it != _slots.end())
+        return it->second;
+
+    size_t index = _slots.size();
+    _slots.insert(std::make_pair(name, index));
+
+    return index;
+}
+
+void StageGraph::runStage(size_t index) {
+    std::vector<Frame::Ptr>& inputs = _inputs[index];
+    std::vector<Frame::Ptr>& outputs = _outputs[index];
+
+    for (size_t slot: _inputSlots[index])
+        if (!_frames[slot])
+            return;
+
+    for (size_t i = 0; i < inputs.size(); i++)
+        inputs[i] = _frames[_inputSlots[index][i]];
+
+    _stages[index]->process(inputs, outputs);
+
+    // Released here, so that the frames can be recycled by their pools.
+    for (size_t i = 0; i < outputs.size(); i++) {
+        _frames[_outputSlots[index][i]] = outputs[i];
+        outputs[i].reset();
+    }
+
+    std::fill(inputs.begin(), inputs.end(), Frame::Ptr());
+}
+
+void StageGraph::update() {
+    uint64_t sequence = 0;
+
+    while (_running) {
+        if (_camera->waitForNextFrame(sequence, 100))
+            process();
+    }
+}
+
+}
@@ -0,0 +1,161 @@
+/**
+ * @file Stages.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <limits>
+#include "rgbd/camera/Stages.h"
+#include "rgbd/camera/Rotate.h"
+#include "rgbd/camera/WhiteBalance.h"
+
+namespace rgbd {
+
+namespace {
+
+std::vector<std::string> names(const std::string& name) {
+    return std::vector<std::string>(1, name);
+}
+
+}
+
+RotateStage::RotateStage(const std::string& input, const std::string& output, int angle) :
+        Stage(names(input), names(output)),
+        _angle(angle) {
+    if (_angle != 0 && _angle != 90 && _angle != -90 && _angle != 180 && _angle != -180)
+        throw UnsupportedException("Angle must be -90, 0, 90, or 180.");
+}
+
+RotateStage::~RotateStage() {
+}
+
+void RotateStage::process(const std::vector<Frame::Ptr>& inputs,
+                          std::vector<Frame::Ptr>& outputs) {
+    const cv::Mat& src = inputs[0]->data;
+    const bool swap = _angle == 90 || _angle == -90;
+    std::shared_ptr<Frame> frame = allocate(0, inputs[0],
+                                            swap ? cv::Size(src.rows, src.cols) : src.size(),
+                                            src.type());
+
+    rotateImage(src, frame->data, _angle);
+    outputs[0] = frame;
+}
+
+UndistortStage::UndistortStage(const std::string& input, const std::string& output,
+                               const std::string& intrinsics, const cv::Size& size) :
+        Stage(names(input), names(output)) {
+    if (!_undistorter.load(intrinsics, size)) {
+        std::cerr << "UndistortStage: cannot load " << intrinsics << std::endl;
+        std::exit(-1);
+    }
+}
+
+UndistortStage::~UndistortStage() {
+}
+
+void UndistortStage::process(const std::vector<Frame::Ptr>& inputs,
+                             std::vector<Frame::Ptr>& outputs) {
+    const cv::Mat& src = inputs[0]->data;
+    std::shared_ptr<Frame> frame = allocate(0, inputs[0], src.size(), src.type());
+
+    _undistorter.undistort(src, frame->data);
+    outputs[0] = frame;
+}
+
+WhiteBalanceStage::WhiteBalanceStage(const std::string& input, const std::string& output) :
+        Stage(names(input), names(output)) {
+    setGrayImage(cv::Mat());
+}
+
+WhiteBalanceStage::~WhiteBalanceStage() {
+}
+
+void WhiteBalanceStage::setGrayImage(const cv::Mat& gray) {
+    double rscale, bscale;
+
+    estimateWhiteBalance(gray, rscale, bscale);
+    buildWhiteBalanceLUT(rscale, bscale, _lut);
+}
+
+void WhiteBalanceStage::process(const std::vector<Frame::Ptr>& inputs,
+                                std::vector<Frame::Ptr>& outputs) {
+    const cv::Mat& src = inputs[0]->data;
+    std::shared_ptr<Frame> frame = allocate(0, inputs[0], src.size(), src.type());
+
+    cv::LUT(src, _lut, frame->data);
+    outputs[0] = frame;
+}
+
+RegisterStage::RegisterStage(std::shared_ptr<DepthRegistrator> registrator,
+                             const std::string& input, const std::string& output) :
+        Stage(names(input), names(output)),
+        _registrator(registrator) {
+}
+
+RegisterStage::~RegisterStage() {
+}
+
+void RegisterStage::process(const std::vector<Frame::Ptr>& inputs,
+                            std::vector<Frame::Ptr>& outputs) {
+    const cv::Mat& depth = inputs[0]->data;
+    std::shared_ptr<Frame> frame = allocate(0, inputs[0], _registrator->depthSize(),
+                                            depth.type());
+
+    _registrator->registerDepth(depth, frame->data);
+    outputs[0] = frame;
+}
+
+PointCloudStage::PointCloudStage(const std::string& input, const std::string& output,
+                                 const cv::Mat& cameraMatrix, const cv::Mat& distCoeffs,
+                                 const cv::Size& size, float depthUnit, float maxDepth) :
+        Stage(names(input), names(output)),
+        _depthUnit(depthUnit),
+        _maxDepth(maxDepth * depthUnit) {
+    cv::Mat pixels(size, CV_32FC2);
+
+    for (int y = 0; y < size.height; y++) {
+        cv::Point2f* p = pixels.ptr<cv::Point2f>(y);
+
+        for (int x = 0; x < size.width; x++)
+            p[x] = cv::Point2f(x, y);
+    }
+
+    cv::undistortPoints(pixels.reshape(2, 1), _rays, cameraMatrix, distCoeffs);
+    _rays = _rays.reshape(2, size.height);
+}
+
+PointCloudStage::~PointCloudStage() {
+}
+
+void PointCloudStage::process(const std::vector<Frame::Ptr>& inputs,
+                              std::vector<Frame::Ptr>& outputs) {
+    const cv::Mat& depth = inputs[0]->data;
+
+    if (depth.size() != _rays.size()) {
+        std::cerr << "PointCloudStage: " << depth.cols << "x" << depth.rows
+                  << " depth does not match the " << _rays.cols << "x" << _rays.rows
+                  << " camera" << std::endl;
+        std::exit(-1);
+    }
+
+    std::shared_ptr<Frame> frame = allocate(0, inputs[0], depth.size(), CV_32FC3);
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    depth.convertTo(_meters, CV_32F, _depthUnit);
+
+    for (int y = 0; y < depth.rows; y++) {
+        const float* z = _meters.ptr<float>(y);
+        const cv::Point2f* ray = _rays.ptr<cv::Point2f>(y);
+        cv::Point3f* point = frame->data.ptr<cv::Point3f>(y);
+
+        for (int x = 0; x < depth.cols; x++) {
+            if (z[x] > 0 && z[x] <= _maxDepth)
+                point[x] = cv::Point3f(ray[x].x * z[x], ray[x].y * z[x], z[x]);
+            else
+                point[x] = cv::Point3f(nan, nan, nan);
+        }
+    }
+
+    outputs[0] = frame;
+}
+
+}
@@ -4,16 +4,216 @@
  * @date Jul 23, 2014
  */
 
+#include <limits>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "rgbd/camera/StereoCamera.h"
+#include "rgbd/camera/Metrics.h"
 
 namespace rgbd {
 
+namespace {
+
+/**
+ * Points farther than this are treated as missing, like the big Z given by
+ * cv::reprojectImageTo3D to pixels without disparity.
+ */
+const float ZMAX = 1.0e4f;
+
+/**
+ * Rectify the left and right images of a pair at the same time.
+ */
+class PairRectifier: public cv::ParallelLoopBody {
+public:
+    PairRectifier(const cv::Mat* images, const cv::Mat* maps, cv::Mat* rectified) :
+            _images(images),
+            _maps(maps),
+            _rectified(rectified) {
+    }
+
+    void operator()(const cv::Range& range) const {
+        for (int i = range.start; i < range.end; i++)
+            cv::remap(_images[i], _rectified[i], _maps[i * 2], _maps[i * 2 + 1], cv::INTER_LINEAR);
+    }
+
+private:
+    const cv::Mat* _images;
+
+    const cv::Mat* _maps;
+
+    cv::Mat* _rectified;
+};
+
+inline void setColor(pcl::PointXYZ& point, const cv::Vec3b* color) {
+}
+
+inline void setColor(pcl::PointXYZRGB& point, const cv::Vec3b* color) {
+    point.b = (*color)[0];
+    point.g = (*color)[1];
+    point.r = (*color)[2];
+}
+
+/**
+ * Reproject rows of a disparity map directly into points, with the y and z
+ * axes flipped. Each row is written from the start of its own slot of width
+ * points, densely unless the cloud is organized, and the number of points
+ * written is returned per row.
+ */
+template <typename PointT>
+class DisparityProjector: public cv::ParallelLoopBody {
+public:
+    DisparityProjector(const cv::Mat& disparity, const cv::Mat& color, const cv::Matx44f& Q,
+                       int minDisparity, bool organized, PointT* points, int* counts) :
+            _disparity(disparity),
+            _color(color),
+            _Q(Q),
+            _minDisparity(minDisparity * 16),
+            _organized(organized),
+            _points(points),
+            _counts(counts) {
+    }
+
+    void operator()(const cv::Range& range) const {
+        for (int y = range.start; y < range.end; y++)
+            _counts[y] = projectRow(y);
+    }
+
+private:
+    const cv::Mat& _disparity;
+
+    const cv::Mat& _color;
+
+    const cv::Matx44f _Q;
+
+    const short _minDisparity;
+
+    const bool _organized;
+
+    PointT* _points;
+
+    int* _counts;
+
+    int projectRow(int y) const {
+        const int cols = _disparity.cols;
+        const short* disparity = _disparity.ptr<short>(y);
+        const cv::Vec3b* color = _color.empty() ? NULL : _color.ptr<cv::Vec3b>(y);
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        PointT* points = _points + (size_t) y * cols;
+        const cv::Matx44f& Q = _Q;
+
+        // Homogeneous point = base + x * Q.col(0) + d * Q.col(2)
+        float base[4];
+
+        for (int i = 0; i < 4; i++)
+            base[i] = Q(i, 1) * y + Q(i, 3);
+
+        int n = 0;
+        int x = 0;
+
+#if defined(__SSE2__)
+        const __m128 bx = _mm_set1_ps(base[0]), by = _mm_set1_ps(base[1]);
+        const __m128 bz = _mm_set1_ps(base[2]), bw = _mm_set1_ps(base[3]);
+        const __m128 q00 = _mm_set1_ps(Q(0, 0)), q02 = _mm_set1_ps(Q(0, 2));
+        const __m128 q10 = _mm_set1_ps(Q(1, 0)), q12 = _mm_set1_ps(Q(1, 2));
+        const __m128 q20 = _mm_set1_ps(Q(2, 0)), q22 = _mm_set1_ps(Q(2, 2));
+        const __m128 q30 = _mm_set1_ps(Q(3, 0)), q32 = _mm_set1_ps(Q(3, 2));
+        const __m128 scale = _mm_set1_ps(1.0f / 16);
+        const __m128 zmax = _mm_set1_ps(ZMAX);
+        const __m128 absmask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128 invalid = _mm_set_ps(1.0f, nan, nan, nan);
+        const __m128i mind = _mm_set1_epi32(_minDisparity - 1);
+        __m128 xs = _mm_set_ps(3, 2, 1, 0);
+
+        for (; x + 4 <= cols; x += 4, xs = _mm_add_ps(xs, _mm_set1_ps(4))) {
+            __m128i d16 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(disparity + x));
+            __m128i d32 = _mm_srai_epi32(_mm_unpacklo_epi16(d16, d16), 16);
+            __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(d32), scale);
+
+            __m128 px = _mm_add_ps(bx, _mm_add_ps(_mm_mul_ps(xs, q00), _mm_mul_ps(d, q02)));
+            __m128 py = _mm_add_ps(by, _mm_add_ps(_mm_mul_ps(xs, q10), _mm_mul_ps(d, q12)));
+            __m128 pz = _mm_add_ps(bz, _mm_add_ps(_mm_mul_ps(xs, q20), _mm_mul_ps(d, q22)));
+            __m128 pw = _mm_add_ps(bw, _mm_add_ps(_mm_mul_ps(xs, q30), _mm_mul_ps(d, q32)));
+            __m128 iw = _mm_div_ps(_mm_set1_ps(1.0f), pw);
+            px = _mm_mul_ps(px, iw);
+            py = _mm_mul_ps(py, iw);
+            pz = _mm_mul_ps(pz, iw);
+
+            // NaN compares false and is dropped together with far points.
+            __m128 valid = _mm_and_ps(_mm_cmplt_ps(_mm_and_ps(pz, absmask), zmax),
+                                      _mm_castsi128_ps(_mm_cmpgt_epi32(d32, mind)));
+            int mask = _mm_movemask_ps(valid);
+
+            if (mask == 0 && !_organized)
+                continue;
+
+            __m128 pt = _mm_set1_ps(1.0f);
+            _MM_TRANSPOSE4_PS(px, py, pz, pt);
+            const __m128 p[4] = { px, py, pz, pt };
+
+            for (int i = 0; i < 4; i++) {
+                if (mask & (1 << i)) {
+                    PointT& point = points[_organized ? x + i : n++];
+                    _mm_storeu_ps(point.data, p[i]);
+
+                    if (color)
+                        setColor(point, color + x + i);
+                } else if (_organized) {
+                    _mm_storeu_ps(points[x + i].data, invalid);
+                }
+            }
+        }
+#endif
+
+        for (; x < cols; x++) {
+            float d = disparity[x] * (1.0f / 16);
+            float w = 1.0f / (base[3] + Q(3, 0) * x + Q(3, 2) * d);
+            float pz = (base[2] + Q(2, 0) * x + Q(2, 2) * d) * w;
+
+            if (disparity[x] < _minDisparity || !(std::fabs(pz) < ZMAX)) {
+                if (_organized)
+                    points[x].x = points[x].y = points[x].z = nan;
+
+                continue;
+            }
+
+            PointT& point = points[_organized ? x : n++];
+            point.x = (base[0] + Q(0, 0) * x + Q(0, 2) * d) * w;
+            point.y = (base[1] + Q(1, 0) * x + Q(1, 2) * d) * w;
+            point.z = pz;
+
+            if (color)
+                setColor(point, color + x);
+        }
+
+        return _organized ? cols : n;
+    }
+};
+
+}
+
 StereoCamera::StereoCamera(std::shared_ptr<ColorCamera> left, std::shared_ptr<ColorCamera> right,
                            const std::string& intrinsics, const std::string& extrinsics) :
         _lcamera(left),
         _rcamera(right),
         _lcolor(cv::Mat::zeros(_lcamera->colorSize(), CV_8UC3)),
-        _rcolor(cv::Mat::zeros(_rcamera->colorSize(), CV_8UC3)) {
+        _rcolor(cv::Mat::zeros(_rcamera->colorSize(), CV_8UC3)),
+        _engine(new SGBMEngine()),
+        _sync(FREE_RUN),
+        _maxSkew(5000),
+        _skew(0),
+        _organized(false),
+        _lsequence(0),
+        _rsequence(0),
+        _unused(false),
+        _running(false),
+        _requested(false),
+        _prefetched(false),
+        _acquired(false),
+        _timeout(1000),
+        _nextSkew(0),
+        _pairTime(0),
+        _period(0) {
     if (_lcamera->colorSize().width != _rcamera->colorSize().width ||
         _lcamera->colorSize().height != _rcamera->colorSize().height) {
         std::cerr << "StereoCamera: left camera size != right camera size" << std::endl;
@@ -21,10 +221,18 @@ StereoCamera::StereoCamera(std::shared_ptr<ColorCamera> left, std::shared_ptr<Co
     }
 
     loadCameraParams(intrinsics, extrinsics);
-    setUpStereoParams();
 }
 
 StereoCamera::~StereoCamera() {
+    {
+        boost::mutex::scoped_lock lock(_pairMutex);
+        _running = false;
+    }
+
+    _pairCondition.notify_all();
+
+    if (_acquirer.joinable())
+        _acquirer.join();
 }
 
 cv::Size StereoCamera::colorSize() const {
@@ -48,6 +256,192 @@ void StereoCamera::start() {
     _rcamera->start();
 }
 
+bool StereoCamera::waitForNextFrame(uint64_t& sequence, int timeout) {
+    const uint64_t deadline = FrameInfo::now() + (uint64_t) timeout * 1000;
+    uint64_t lsequence = sequence;
+    uint64_t rsequence = 0;
+
+    // Both cameras are waited for against one deadline, the right one for a
+    // frame newer than the one it has now, so that the pair is a new one.
+    _rcamera->waitForNextFrame(rsequence, 0);
+
+    if (!_lcamera->waitForNextFrame(lsequence, timeout))
+        return false;
+
+    const uint64_t now = FrameInfo::now();
+
+    if (!_rcamera->waitForNextFrame(rsequence, now < deadline ? (deadline - now) / 1000 : 0))
+        return false;
+
+    sequence = lsequence;
+
+    return true;
+}
+
+void StereoCamera::setDisparityEngine(DisparityEngine::Ptr engine) {
+    _engine = engine;
+}
+
+void StereoCamera::setSynchronization(TriggerMode mode, uint64_t maxSkew) {
+    // The pair being acquired is dropped, as it may not match the mode.
+    boost::mutex::scoped_lock lock(_pairMutex);
+    _pairCondition.wait(lock, [this] { return !_requested; });
+    _prefetched = false;
+
+    _sync = mode;
+    _maxSkew = maxSkew;
+
+    _lcamera->setTriggerMode(mode == HARDWARE_TRIGGER ? FREE_RUN : mode);
+    _rcamera->setTriggerMode(mode);
+}
+
+bool StereoCamera::captureStereoPair(cv::Mat& left, cv::Mat& right, int timeout) {
+    if (!nextPair(timeout))
+        return false;
+
+    _lpair.copyTo(left);
+    _rpair.copyTo(right);
+    _lcolor = left;
+    _rcolor = right;
+    _unused = true;
+
+    return true;
+}
+
+bool StereoCamera::nextPair(int timeout) {
+    boost::mutex::scoped_lock lock(_pairMutex);
+
+    if (!_acquirer.joinable()) {
+        _running = true;
+        _acquirer = boost::thread(&StereoCamera::acquire, this);
+    }
+
+    _pairCondition.wait(lock, [this] { return !_requested; });
+
+    // The next pair was acquired right after the current one was returned,
+    // so it has been waiting while the caller was idle if the caller took
+    // much longer than for the previous pair.
+    const uint64_t now = FrameInfo::now();
+    const bool stale = _period > 0 && now - _pairTime > 2 * _period;
+
+    if (!_prefetched || !_acquired || stale) {
+        _requested = true;
+        _timeout = timeout;
+        _pairCondition.notify_all();
+        _pairCondition.wait(lock, [this] { return !_requested; });
+    }
+
+    _prefetched = false;
+
+    if (!_acquired)
+        return false;
+
+    cv::swap(_lnext, _lpair);
+    cv::swap(_rnext, _rpair);
+    _skew = _nextSkew;
+    _period = _pairTime > 0 ? now - _pairTime : 0;
+    _pairTime = now;
+
+    // Acquire the pair after this one while the caller works on this one.
+    _requested = true;
+    _timeout = timeout;
+    _pairCondition.notify_all();
+
+    return true;
+}
+
+void StereoCamera::acquire() {
+    boost::mutex::scoped_lock lock(_pairMutex);
+
+    while (true) {
+        _pairCondition.wait(lock, [this] { return _requested || !_running; });
+
+        if (!_running)
+            break;
+
+        const int timeout = _timeout;
+        lock.unlock();
+
+        Frame::Ptr lframe, rframe;
+        int64_t skew = 0;
+        const bool acquired = acquireStereoPair(lframe, rframe, skew, timeout);
+
+        if (acquired)
+            rectifyStereoPair(lframe, rframe, _lnext, _rnext);
+
+        lock.lock();
+        _acquired = acquired;
+        _nextSkew = skew;
+        _prefetched = true;
+        _requested = false;
+        _pairCondition.notify_all();
+    }
+}
+
+bool StereoCamera::acquireStereoPair(Frame::Ptr& lframe, Frame::Ptr& rframe, int64_t& skew,
+                                     int timeout) {
+    static Counter& dropped = Metrics::instance().counter("stereo_camera.pair.dropped");
+    const int retries = 3;
+
+    for (int i = 0; i <= retries; i++) {
+        if (_sync == SOFTWARE_TRIGGER) {
+            // Skip frames left over from a previous trigger.
+            _lcamera->waitForNextFrame(_lsequence, 0);
+            _rcamera->waitForNextFrame(_rsequence, 0);
+            _lcamera->trigger();
+            _rcamera->trigger();
+        }
+
+        // In FREE_RUN the latest frames are taken if no new one arrives in
+        // time, so that a stalled camera does not stop the other one.
+        if (_sync == FREE_RUN || _sync == SOFTWARE_TRIGGER || !lframe ||
+            lframe->info.hostTime <= rframe->info.hostTime) {
+            if (!_lcamera->waitForNextFrame(_lsequence, timeout) && _sync != FREE_RUN)
+                return false;
+
+            lframe = _lcamera->acquireColorFrame();
+        }
+        if (_sync == FREE_RUN || _sync == SOFTWARE_TRIGGER || !rframe ||
+            rframe->info.hostTime < lframe->info.hostTime) {
+            if (!_rcamera->waitForNextFrame(_rsequence, timeout) && _sync != FREE_RUN)
+                return false;
+
+            rframe = _rcamera->acquireColorFrame();
+        }
+        if (!lframe || !rframe)
+            return false;
+
+        skew = (int64_t) lframe->info.hostTime - (int64_t) rframe->info.hostTime;
+
+        if (_sync == FREE_RUN || (uint64_t) std::abs(skew) <= _maxSkew)
+            break;
+
+        dropped.add();
+
+        if (i == retries)
+            return false;
+    }
+
+    return true;
+}
+
+void StereoCamera::rectifyStereoPair(const Frame::Ptr& lframe, const Frame::Ptr& rframe,
+                                     cv::Mat& left, cv::Mat& right) {
+    static Histogram& process = Metrics::instance().histogram("stereo_camera.color.process");
+    ScopedTimer timer(process);
+    const cv::Mat images[] = { lframe->data, rframe->data };
+    const cv::Mat maps[] = { _map11, _map12, _map21, _map22 };
+    cv::Mat rectified[] = { left, right };
+
+    cv::parallel_for_(cv::Range(0, 2), PairRectifier(images, maps, rectified));
+    left = rectified[0];
+    right = rectified[1];
+}
+
+int64_t StereoCamera::lastSkew() const {
+    return _skew;
+}
+
 void StereoCamera::captureColor(cv::Mat& buffer) {
     captureColorL(buffer);
 }
@@ -64,67 +458,80 @@ void StereoCamera::captureColorR(cv::Mat& buffer) {
     _rcolor = buffer;
 }
 
-cv::Mat StereoCamera::reprojectImage() {
-    cv::Mat disparity, xyz;
-
-    _sgbm(_lcolor, _rcolor, disparity);
-    cv::reprojectImageTo3D(disparity, xyz, _Q, true);
+cv::Mat StereoCamera::computeDisparity(const cv::Mat& left, const cv::Mat& right) {
+    static Histogram& process = Metrics::instance().histogram("stereo_camera.disparity.process");
+    ScopedTimer timer(process);
+    _engine->compute(left, right, _disparity);
 
-    return xyz;
+    return _disparity;
 }
 
-void StereoCamera::capturePointCloud(PointCloud::Ptr buffer) {
-    cv::Mat xyz = reprojectImage();
+template <typename PointT>
+void StereoCamera::projectDisparity(const cv::Mat& disparity, const cv::Mat& color,
+                                    pcl::PointCloud<PointT>& cloud) {
+    static Histogram& process = Metrics::instance().histogram("stereo_camera.cloud.process");
+    ScopedTimer timer(process);
+    const int cols = disparity.cols;
+    const int rows = disparity.rows;
 
-    buffer->points.clear();
-    size_t index = 0;
-    double zmax = 1.0e4;
+    // Flip the y and z axes in the reprojection matrix itself.
+    cv::Matx44f Q = _Q;
 
-    for (int y = 0; y < xyz.rows; y++) {
-        for (int x = 0; x < xyz.cols; x++) {
-            cv::Vec3f p = xyz.at<cv::Vec3f>(y, x);
+    for (int i = 0; i < 4; i++) {
+        Q(1, i) = -Q(1, i);
+        Q(2, i) = -Q(2, i);
+    }
 
-            if (fabs(p[2] - zmax) < FLT_EPSILON || fabs(p[2]) >= zmax)
-                continue;
+    cloud.points.resize((size_t) cols * rows);
+    _counts.resize(rows);
+    cv::parallel_for_(cv::Range(0, rows), DisparityProjector<PointT>(
+            disparity, color, Q, _engine->minDisparity(), _organized,
+            cloud.points.data(), _counts.data()));
+
+    if (_organized) {
+        cloud.width = cols;
+        cloud.height = rows;
+        cloud.is_dense = false;
+        return;
+    }
 
-            pcl::PointXYZ point;
-            point.x = p[0];
-            point.y = -p[1];
-            point.z = -p[2];
+    // Pack the rows, which only moves points toward the front.
+    size_t size = 0;
 
-            buffer->points.push_back(point);
-        }
-    }
-}
+    for (int y = 0; y < rows; y++) {
+        auto begin = cloud.points.begin() + (size_t) y * cols;
 
-void StereoCamera::captureColoredPointCloud(ColoredPointCloud::Ptr buffer) {
-    captureColorL(_lcolor);
-    captureColorR(_rcolor);
-    cv::Mat xyz = reprojectImage();
+        if (size != (size_t) y * cols)
+            std::copy(begin, begin + _counts[y], cloud.points.begin() + size);
 
-    buffer->points.clear();
-    size_t index = 0;
-    double zmax = 1.0e4;
+        size += _counts[y];
+    }
 
-    for (int y = 0; y < xyz.rows; y++) {
-        for (int x = 0; x < xyz.cols; x++) {
-            cv::Vec3f p = xyz.at<cv::Vec3f>(y, x);
+    cloud.points.resize(size);
+    cloud.width = size;
+    cloud.height = 1;
+    cloud.is_dense = true;
+}
 
-            if (fabs(p[2] - zmax) < FLT_EPSILON || fabs(p[2]) >= zmax)
-                continue;
+void StereoCamera::setOrganized(bool organized) {
+    _organized = organized;
+}
 
-            cv::Vec3b bgr = _lcolor.at<cv::Vec3b>(y, x);
-            pcl::PointXYZRGB point;
-            point.x = p[0];
-            point.y = -p[1];
-            point.z = -p[2];
-            point.b = bgr[0];
-            point.g = bgr[1];
-            point.r = bgr[2];
+void StereoCamera::capturePointCloud(PointCloud::Ptr buffer) {
+    projectDisparity(computeDisparity(_lcolor, _rcolor), cv::Mat(), *buffer);
+}
 
-            buffer->points.push_back(point);
-        }
+void StereoCamera::captureColoredPointCloud(ColoredPointCloud::Ptr buffer) {
+    if (!_unused) {
+        if (!nextPair(1000))
+            return;
+
+        _lpair.copyTo(_lcolor);
+        _rpair.copyTo(_rcolor);
     }
+
+    _unused = false;
+    projectDisparity(computeDisparity(_lpair, _rpair), _lpair, *buffer);
 }
 
 void StereoCamera::loadCameraParams(const std::string& intrinsics,
@@ -164,18 +571,4 @@ void StereoCamera::loadCameraParams(const std::string& intrinsics,
     std::cout << "StereoCamera: undistorted" << std::endl;
 }
 
-void StereoCamera::setUpStereoParams() {
-    _sgbm.preFilterCap = 63;
-    _sgbm.SADWindowSize = 3;
-    _sgbm.P1 = 8 * 3 * _sgbm.SADWindowSize * _sgbm.SADWindowSize;
-    _sgbm.P2 = 32 * 3 * _sgbm.SADWindowSize * _sgbm.SADWindowSize;
-    _sgbm.minDisparity = 0;
-    _sgbm.numberOfDisparities = 64;
-    _sgbm.uniquenessRatio = 10;
-    _sgbm.speckleWindowSize = 100;
-    _sgbm.speckleRange = 32;
-    _sgbm.disp12MaxDiff = 1;
-    _sgbm.fullDP = false;
-}
-
 }
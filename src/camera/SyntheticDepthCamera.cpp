@@ -0,0 +1,400 @@
+/**
+ * @file SyntheticDepthCamera.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <cmath>
+#include <limits>
+#include <atomic>
+#include "rgbd/camera/SyntheticDepthCamera.h"
+
+namespace rgbd {
+
+namespace {
+
+/**
+ * Number of cameras opened so far, which tells the metrics of each apart.
+ */
+std::atomic<uint> opened(0);
+
+/**
+ * Horizontal field of view of both cameras in radians.
+ */
+const float FOV = 74.0f * M_PI / 180.0f;
+
+/**
+ * The wall is the plane z = WALL_DISTANCE + WALL_TILT * x in meters.
+ */
+const float WALL_DISTANCE = 1.2f;
+
+const float WALL_TILT = 0.3f;
+
+const float CHECKER = 0.1f;
+
+const float SPHERE_RADIUS = 0.12f;
+
+/**
+ * Amplitude of a white surface at 1 meter.
+ */
+const float AMPLITUDE = 800.0f;
+
+struct Scene {
+    float center[3];
+};
+
+Scene sceneAt(double time) {
+    const double omega = 2 * M_PI / 4.0;
+    Scene scene;
+    scene.center[0] = 0.15 * std::sin(omega * time);
+    scene.center[1] = 0.08 * std::cos(omega * time);
+    scene.center[2] = 0.6 + 0.1 * std::sin(0.5 * omega * time);
+
+    return scene;
+}
+
+/**
+ * Return the depth at which the ray (x, y, 1) hits the scene.
+ */
+inline float intersect(const Scene& scene, float x, float y, bool& onSphere) {
+    float z = WALL_DISTANCE / (1 - WALL_TILT * x);
+    const float* c = scene.center;
+    float a = x * x + y * y + 1;
+    float b = x * c[0] + y * c[1] + c[2];
+    float d = b * b - a * (c[0] * c[0] + c[1] * c[1] + c[2] * c[2] -
+                           SPHERE_RADIUS * SPHERE_RADIUS);
+    onSphere = false;
+
+    if (d >= 0) {
+        float t = (b - std::sqrt(d)) / a;
+
+        if (t > 0 && t < z) {
+            z = t;
+            onSphere = true;
+        }
+    }
+
+    return z;
+}
+
+/**
+ * Pinhole camera of the field of view FOV.
+ */
+struct Pinhole {
+    Pinhole(const cv::Size& size) :
+            f(size.width / (2 * std::tan(FOV / 2))),
+            cx((size.width - 1) * 0.5f),
+            cy((size.height - 1) * 0.5f) {
+    }
+
+    float f, cx, cy;
+};
+
+class DepthRenderer: public cv::ParallelLoopBody {
+public:
+    DepthRenderer(const Scene& scene, cv::Mat& depth, cv::Mat& amplitude, cv::Mat& vertex) :
+            _scene(scene),
+            _pinhole(depth.size()),
+            _depth(depth),
+            _amplitude(amplitude),
+            _vertex(vertex) {
+    }
+
+    void operator()(const cv::Range& range) const {
+        for (int v = range.start; v < range.end; v++) {
+            if (_depth.type() == CV_16U)
+                renderRow(v, _depth.ptr<ushort>(v), _amplitude.ptr<ushort>(v), 1000.0f);
+            else
+                renderRow(v, _depth.ptr<float>(v), _amplitude.ptr<float>(v), 1.0f);
+        }
+    }
+
+private:
+    const Scene _scene;
+
+    const Pinhole _pinhole;
+
+    cv::Mat& _depth;
+
+    cv::Mat& _amplitude;
+
+    cv::Mat& _vertex;
+
+    template <typename T>
+    void renderRow(int v, T* depth, T* amplitude, float scale) const {
+        const float y = (v - _pinhole.cy) / _pinhole.f;
+        cv::Point3f* vertex = _vertex.ptr<cv::Point3f>(v);
+
+        for (int u = 0; u < _depth.cols; u++) {
+            const float x = (u - _pinhole.cx) / _pinhole.f;
+            bool onSphere;
+            float z = intersect(_scene, x, y, onSphere);
+            float a = (onSphere ? 1.0f : 0.6f) * AMPLITUDE / (z * z);
+
+            depth[u] = cv::saturate_cast<T>(z * scale);
+            amplitude[u] = cv::saturate_cast<T>(a);
+            vertex[u] = cv::Point3f(x * z, y * z, z);
+        }
+    }
+};
+
+class ColorRenderer: public cv::ParallelLoopBody {
+public:
+    ColorRenderer(const Scene& scene, cv::Mat& color) :
+            _scene(scene),
+            _pinhole(color.size()),
+            _color(color) {
+    }
+
+    void operator()(const cv::Range& range) const {
+        // Light from the upper left behind the camera.
+        const float light[3] = { 0.3f, 0.5f, -0.81f };
+        const float* c = _scene.center;
+
+        for (int v = range.start; v < range.end; v++) {
+            const float y = (v - _pinhole.cy) / _pinhole.f;
+            cv::Vec3b* color = _color.ptr<cv::Vec3b>(v);
+
+            for (int u = 0; u < _color.cols; u++) {
+                const float x = (u - _pinhole.cx) / _pinhole.f;
+                bool onSphere;
+                float z = intersect(_scene, x, y, onSphere);
+                cv::Vec3b& p = color[u];
+
+                if (onSphere) {
+                    float n[3] = { (x * z - c[0]) / SPHERE_RADIUS, (y * z - c[1]) / SPHERE_RADIUS,
+                                   (z - c[2]) / SPHERE_RADIUS };
+                    float lambert = std::max(0.0f, -(n[0] * light[0] + n[1] * light[1] +
+                                                     n[2] * light[2]));
+                    p[0] = 40;
+                    p[1] = 40;
+                    p[2] = (uchar) (60 + 195 * lambert);
+                } else {
+                    int checker = (int) std::floor(x * z / CHECKER) +
+                            (int) std::floor(y * z / CHECKER);
+                    p[0] = p[1] = p[2] = (checker & 1) ? 200 : 90;
+                }
+            }
+        }
+    }
+
+private:
+    const Scene _scene;
+
+    const Pinhole _pinhole;
+
+    cv::Mat& _color;
+};
+
+}
+
+SyntheticDepthCamera::SyntheticDepthCamera(Model model, double fps) :
+        SyntheticDepthCamera(model == DS325_MODEL ? cv::Size(320, 240) : cv::Size(160, 120),
+                             model == DS325_MODEL ? cv::Size(1280, 720) : cv::Size(),
+                             model == DS325_MODEL ? CV_16U : CV_32F, fps) {
+}
+
+SyntheticDepthCamera::SyntheticDepthCamera(const cv::Size& depthSize, const cv::Size& colorSize,
+                                           int depthType, double fps) :
+        DepthCamera(),
+        _dsize(depthSize),
+        _csize(colorSize),
+        _depthType(depthType),
+        _period((uint64_t) (1.0e6 / fps)),
+        _running(false) {
+    if (_depthType != CV_16U && _depthType != CV_32F) {
+        std::cerr << "SyntheticDepthCamera: depth must be CV_16U or CV_32F" << std::endl;
+        std::exit(-1);
+    }
+
+    const std::string name = "synthetic." + std::to_string(opened++);
+    _dframes.instrument(name + ".depth");
+    _aframes.instrument(name + ".amplitude");
+    _vframes.instrument(name + ".vertex");
+    _cframes.instrument(name + ".color");
+
+    std::cout << "SyntheticDepthCamera: opened" << std::endl;
+}
+
+SyntheticDepthCamera::~SyntheticDepthCamera() {
+    _running = false;
+
+    if (_thread.joinable())
+        _thread.join();
+
+    std::cout << "SyntheticDepthCamera: closed" << std::endl;
+}
+
+cv::Size SyntheticDepthCamera::colorSize() const {
+    if (_csize.area() == 0)
+        throw new UnsupportedException("colorSize");
+
+    return _csize;
+}
+
+cv::Size SyntheticDepthCamera::depthSize() const {
+    return _dsize;
+}
+
+void SyntheticDepthCamera::start() {
+    if (_running)
+        return;
+
+    _running = true;
+    _thread = boost::thread(boost::bind(&SyntheticDepthCamera::update, this));
+}
+
+bool SyntheticDepthCamera::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return _dframes.waitForNext(sequence, timeout);
+}
+
+void SyntheticDepthCamera::update() {
+    const uint64_t origin = FrameInfo::now();
+    uint64_t count = 0;
+    uint64_t dropped = 0;
+
+    while (_running) {
+        uint64_t due = origin + count * _period;
+        uint64_t now = FrameInfo::now();
+
+        // Frames whose time has passed while rendering are dropped, as a
+        // device does when it is not read fast enough.
+        if (now < due) {
+            boost::this_thread::sleep(boost::posix_time::microseconds(due - now));
+        } else if (now - due >= _period) {
+            uint64_t late = (now - due) / _period;
+            dropped += late;
+            count += late;
+        }
+
+        FrameInfo info;
+        info.hostTime = FrameInfo::now();
+        info.deviceTime = count * _period;
+        info.dropped = dropped;
+        const Scene scene = sceneAt(info.deviceTime * 1.0e-6);
+
+        if (_csize.area() > 0) {
+            std::shared_ptr<Frame> color = _cframes.allocate(_csize, CV_8UC3);
+            cv::parallel_for_(cv::Range(0, _csize.height), ColorRenderer(scene, color->data));
+            color->info = info;
+            _cframes.publish(color);
+        }
+
+        std::shared_ptr<Frame> depth = _dframes.allocate(_dsize, _depthType);
+        std::shared_ptr<Frame> amplitude = _aframes.allocate(_dsize, _depthType);
+        std::shared_ptr<Frame> vertex = _vframes.allocate(_dsize, CV_32FC3);
+        cv::parallel_for_(cv::Range(0, _dsize.height),
+                          DepthRenderer(scene, depth->data, amplitude->data, vertex->data));
+
+        depth->info = info;
+        amplitude->info = info;
+        vertex->info = info;
+        _vframes.publish(vertex);
+        _aframes.publish(amplitude);
+        _dframes.publish(depth);
+        count++;
+    }
+}
+
+void SyntheticDepthCamera::captureColor(cv::Mat& buffer) {
+    Frame::Ptr frame = _cframes.latest();
+
+    if (frame)
+        frame->data.copyTo(buffer);
+}
+
+Frame::Ptr SyntheticDepthCamera::acquireColorFrame() {
+    return _cframes.latest();
+}
+
+void SyntheticDepthCamera::captureDepth(cv::Mat& buffer) {
+    Frame::Ptr frame = _dframes.latest();
+
+    if (frame)
+        frame->data.copyTo(buffer);
+}
+
+Frame::Ptr SyntheticDepthCamera::acquireDepthFrame() {
+    return _dframes.latest();
+}
+
+void SyntheticDepthCamera::captureAmplitude(cv::Mat& buffer) {
+    Frame::Ptr frame = _aframes.latest();
+
+    if (frame)
+        frame->data.copyTo(buffer);
+}
+
+Frame::Ptr SyntheticDepthCamera::acquireAmplitudeFrame() {
+    return _aframes.latest();
+}
+
+void SyntheticDepthCamera::capturePointCloud(PointCloud::Ptr buffer) {
+    Frame::Ptr frame = _vframes.latest();
+
+    if (!frame)
+        return;
+
+    const cv::Point3f* vertex = frame->data.ptr<cv::Point3f>();
+    stampHeader(buffer->header, frame->info);
+    buffer->points.resize(_dsize.area());
+    buffer->width = _dsize.width;
+    buffer->height = _dsize.height;
+    buffer->is_dense = true;
+
+    for (auto& point: buffer->points) {
+        point.x = vertex->x;
+        point.y = vertex->y;
+        point.z = vertex->z;
+        vertex++;
+    }
+}
+
+void SyntheticDepthCamera::captureColoredPointCloud(ColoredPointCloud::Ptr buffer) {
+    if (_csize.area() == 0)
+        throw new UnsupportedException("captureColoredPointCloud");
+
+    Frame::Ptr frame = _vframes.latest();
+    Frame::Ptr color = _cframes.latest();
+
+    if (!frame || !color)
+        return;
+
+    stampHeader(buffer->header, frame->info);
+    buffer->points.resize(_dsize.area());
+    buffer->width = _dsize.width;
+    buffer->height = _dsize.height;
+    buffer->is_dense = true;
+
+    // Both cameras share the viewpoint and the horizontal field of view, so
+    // the ray of a depth pixel is projected into the color camera. Color of
+    // another aspect ratio does not cover some rows or columns of depth,
+    // whose points are black.
+    const Pinhole depth(_dsize), camera(_csize);
+    const float scale = camera.f / depth.f;
+    std::vector<int> columns(_dsize.width);
+
+    for (int u = 0; u < _dsize.width; u++)
+        columns[u] = cvRound(camera.cx + (u - depth.cx) * scale);
+
+    for (int v = 0; v < _dsize.height; v++) {
+        const cv::Point3f* vertex = frame->data.ptr<cv::Point3f>(v);
+        const int row = cvRound(camera.cy + (v - depth.cy) * scale);
+        const cv::Vec3b* pixels = row >= 0 && row < _csize.height ?
+                color->data.ptr<cv::Vec3b>(row) : NULL;
+        pcl::PointXYZRGB* points = &buffer->points[v * _dsize.width];
+
+        for (int u = 0; u < _dsize.width; u++) {
+            const bool inside = pixels && columns[u] >= 0 && columns[u] < _csize.width;
+            const cv::Vec3b p = inside ? pixels[columns[u]] : cv::Vec3b();
+            points[u].x = vertex[u].x;
+            points[u].y = vertex[u].y;
+            points[u].z = vertex[u].z;
+            points[u].b = p[0];
+            points[u].g = p[1];
+            points[u].r = p[2];
+        }
+    }
+}
+
+}
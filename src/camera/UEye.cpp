@@ -8,11 +8,172 @@
 
 namespace rgbd {
 
+/**
+ * Frames wrapping the locked image memories and the storage of their
+ * control blocks, which are reused instead of allocated for every frame.
+ * Frames share the recycler, since they may be released after the camera
+ * is destroyed.
+ */
+class UEye::Recycler: public std::enable_shared_from_this<UEye::Recycler> {
+public:
+    Recycler(const std::shared_ptr<ueye_cam::UEyeCamDriver>& driver) :
+            _driver(driver),
+            _blockSize(0) {
+    }
+
+    ~Recycler() {
+        for (Frame* frame: _frames)
+            delete frame;
+
+        for (void* block: _blocks)
+            ::operator delete(block);
+    }
+
+    /**
+     * Wrap a locked image memory, which is unlocked when the last consumer
+     * releases the frame.
+     */
+    std::shared_ptr<Frame> wrap(char* data) {
+        Frame* frame = NULL;
+
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+
+            if (!_frames.empty()) {
+                frame = _frames.back();
+                _frames.pop_back();
+            }
+        }
+
+        if (!frame)
+            frame = new Frame();
+
+        std::shared_ptr<Recycler> self = shared_from_this();
+
+        return std::shared_ptr<Frame>(frame, Deleter(self, data), Allocator<Frame>(self));
+    }
+
+private:
+    struct Deleter {
+        Deleter(const std::shared_ptr<Recycler>& recycler, char* data) :
+                recycler(recycler),
+                data(data) {
+        }
+
+        void operator()(Frame* frame) const {
+            recycler->release(frame, data);
+        }
+
+        std::shared_ptr<Recycler> recycler;
+
+        char* data;
+    };
+
+    /**
+     * Allocator of the control blocks, which keeps the recycler until the
+     * control block is deallocated.
+     */
+    template <typename T>
+    struct Allocator {
+        typedef T value_type;
+
+        Allocator(const std::shared_ptr<Recycler>& recycler) :
+                recycler(recycler) {
+        }
+
+        template <typename U>
+        Allocator(const Allocator<U>& other) :
+                recycler(other.recycler) {
+        }
+
+        T* allocate(size_t n) {
+            return static_cast<T*>(recycler->allocate(n * sizeof (T)));
+        }
+
+        void deallocate(T* p, size_t n) {
+            recycler->deallocate(p, n * sizeof (T));
+        }
+
+        template <typename U>
+        bool operator==(const Allocator<U>& other) const {
+            return recycler == other.recycler;
+        }
+
+        template <typename U>
+        bool operator!=(const Allocator<U>& other) const {
+            return recycler != other.recycler;
+        }
+
+        std::shared_ptr<Recycler> recycler;
+    };
+
+    std::shared_ptr<ueye_cam::UEyeCamDriver> _driver;
+
+    std::vector<Frame*> _frames;
+
+    /**
+     * Released control blocks, which are all of the same size.
+     */
+    std::vector<void*> _blocks;
+
+    size_t _blockSize;
+
+    boost::mutex _mutex;
+
+    void release(Frame* frame, char* data) {
+        _driver->unlockFrame(data);
+        frame->data.release();
+
+        boost::mutex::scoped_lock lock(_mutex);
+        _frames.push_back(frame);
+    }
+
+    void* allocate(size_t bytes) {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+
+            if (bytes == _blockSize && !_blocks.empty()) {
+                void* block = _blocks.back();
+                _blocks.pop_back();
+
+                return block;
+            }
+        }
+
+        return ::operator new(bytes);
+    }
+
+    void deallocate(void* block, size_t bytes) {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+
+            if (_blockSize == 0)
+                _blockSize = bytes;
+
+            if (bytes == _blockSize) {
+                _blocks.push_back(block);
+                return;
+            }
+        }
+
+        ::operator delete(block);
+    }
+};
+
 UEye::UEye(const uint deviceNo, const std::string& file,
-           const std::string& name) :
+           const std::string& name, const uint buffers) :
         _deviceNo(deviceNo),
-        _driver(new ueye_cam::UEyeCamDriver(deviceNo, name)),
-        _size(640, 480) {
+        _driver(new ueye_cam::UEyeCamDriver(deviceNo, name, buffers)),
+        _recycler(std::make_shared<Recycler>(_driver)),
+        _size(640, 480),
+        _mode(FREE_RUN),
+        _running(false),
+        _frameNumber(0),
+        _dropped(0),
+        _deviceDropped(&Metrics::instance().counter(
+                "ueye." + std::to_string(deviceNo) + ".color.device_dropped")) {
+    _frames.instrument("ueye." + std::to_string(deviceNo) + ".color");
+
     if (_driver->connectCam() != IS_SUCCESS) {
         std::cerr << "UEye: failed to initialize UEye camera" << std::endl;
         std::exit(-1);
@@ -22,7 +183,14 @@ UEye::UEye(const uint deviceNo, const std::string& file,
 }
 
 UEye::~UEye() {
-    _driver->disconnectCam();
+    _running = false;
+
+    if (_thread.joinable())
+        _thread.join();
+
+    // Frames still held keep the driver, which disconnects the camera once
+    // the last of them is released.
+    _driver->setStandbyMode();
 }
 
 cv::Size UEye::colorSize() const {
@@ -34,19 +202,78 @@ std::shared_ptr<ueye_cam::UEyeCamDriver> UEye::driver() {
 }
 
 void UEye::start() {
-    if (_driver->setFreeRunMode() != IS_SUCCESS) {
+    applyTriggerMode();
+
+    _running = true;
+    _thread = boost::thread(boost::bind(&UEye::update, this));
+}
+
+void UEye::setTriggerMode(TriggerMode mode) {
+    _mode = mode;
+
+    if (_running)
+        applyTriggerMode();
+}
+
+void UEye::trigger() {
+    if (_driver->triggerFrame() != IS_SUCCESS)
+        std::cerr << "UEye: failed to trigger UEye camera" << std::endl;
+}
+
+void UEye::applyTriggerMode() {
+    INT is_err = IS_SUCCESS;
+
+    if (_mode == SOFTWARE_TRIGGER)
+        is_err = _driver->setSoftTriggerMode();
+    else if (_mode == HARDWARE_TRIGGER)
+        is_err = _driver->setExtTriggerMode();
+    else
+        is_err = _driver->setFreeRunMode();
+
+    if (is_err != IS_SUCCESS) {
         std::cerr << "UEye: failed to start capturing UEye camera" << std::endl;
         std::exit(-1);
     }
 }
 
+void UEye::update() {
+    while (_running) {
+        // Wake up every second to check whether the camera is still running.
+        UEYEIMAGEINFO info;
+        char* data = _driver->lockNextFrame(1000, &info);
+
+        if (data == NULL)
+            continue;
+
+        std::shared_ptr<Frame> frame = _recycler->wrap(data);
+        frame->data = cv::Mat(_size, CV_8UC3, data, _driver->getBufferPitch());
+        frame->info.hostTime = FrameInfo::now();
+        frame->info.deviceTime = info.u64TimestampDevice / 10; // 0.1[us]
+
+        if (_frameNumber != 0 && info.u64FrameNumber > _frameNumber + 1) {
+            _dropped += info.u64FrameNumber - _frameNumber - 1;
+            _deviceDropped->add(info.u64FrameNumber - _frameNumber - 1);
+        }
+
+        _frameNumber = info.u64FrameNumber;
+        frame->info.dropped = _dropped;
+        _frames.publish(frame);
+    }
+}
+
+bool UEye::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return _frames.waitForNext(sequence, timeout);
+}
+
 void UEye::captureColor(cv::Mat& buffer) {
-    boost::mutex::scoped_lock lock(_mutex);
+    Frame::Ptr frame = _frames.latest();
+
+    if (frame)
+        frame->data.copyTo(buffer);
+}
 
-    // Wait for up to 10 sec to capture next frame.
-    const char* data = _driver->processNextFrame(10000);
-    std::memcpy(buffer.data, data,
-                3 * sizeof (uchar) * _size.width * _size.height);
+Frame::Ptr UEye::acquireColorFrame() {
+    return _frames.latest();
 }
 
 }
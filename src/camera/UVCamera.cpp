@@ -12,6 +12,7 @@ UVCamera::UVCamera(size_t deviceNo, const cv::Size& size, double fps) :
         _capture(deviceNo),
         _size(size),
         _usleep(1000000 / fps) {
+    _frames.instrument("uvc." + std::to_string(deviceNo) + ".color");
     _capture.set(CV_CAP_PROP_FRAME_WIDTH, size.width);
     _capture.set(CV_CAP_PROP_FRAME_HEIGHT, size.height);
     if (!_capture.isOpened())
@@ -32,20 +33,35 @@ void UVCamera::start() {
     boost::thread t(boost::bind(&UVCamera::update, this));
 }
 
+bool UVCamera::waitForNextFrame(uint64_t& sequence, int timeout) {
+    return _frames.waitForNext(sequence, timeout);
+}
+
 void UVCamera::update() {
     while (_capture.isOpened()) {
         usleep(_usleep);
 
-        {
-            boost::mutex::scoped_lock lock(_mutex);
-            _capture >> _buffer;
+        std::shared_ptr<Frame> frame = _frames.allocate(_size, CV_8UC3);
+
+        if (_capture.read(frame->data)) {
+            // Live captures may report -1, which is no timestamp.
+            const double msec = _capture.get(CV_CAP_PROP_POS_MSEC);
+            frame->info.hostTime = FrameInfo::now();
+            frame->info.deviceTime = msec > 0 ? (uint64_t) (msec * 1000) : 0;
+            _frames.publish(frame);
         }
     }
 }
 
 void UVCamera::captureColor(cv::Mat& buffer) {
-    boost::mutex::scoped_lock lock(_mutex);
-    _buffer.copyTo(buffer);
+    Frame::Ptr frame = _frames.latest();
+
+    if (frame)
+        frame->data.copyTo(buffer);
+}
+
+Frame::Ptr UVCamera::acquireColorFrame() {
+    return _frames.latest();
 }
 
 }
@@ -0,0 +1,176 @@
+/**
+ * @file Undistorter.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include "rgbd/camera/Undistorter.h"
+
+namespace rgbd {
+
+namespace {
+
+const char MAGIC[8] = { 'R', 'G', 'B', 'D', 'M', 'A', 'P', '1' };
+
+/**
+ * FNV-1a hash of the file contents, or 0 if it cannot be read.
+ */
+uint64_t hashFile(const std::string& file) {
+    std::ifstream in(file.c_str(), std::ios::binary);
+
+    if (!in)
+        return 0;
+
+    uint64_t hash = 14695981039346656037ULL;
+    std::istreambuf_iterator<char> it(in), end;
+
+    for (; it != end; ++it) {
+        hash ^= (unsigned char) *it;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+class Remapper: public cv::ParallelLoopBody {
+public:
+    Remapper(const cv::Mat& src, cv::Mat& dst, const cv::Mat* maps, int bands) :
+            _src(src),
+            _dst(dst),
+            _maps(maps),
+            _bands(bands) {
+    }
+
+    void operator()(const cv::Range& range) const {
+        for (int i = range.start; i < range.end; i++) {
+            int y0 = _dst.rows * i / _bands;
+            int y1 = _dst.rows * (i + 1) / _bands;
+            cv::Mat band = _dst.rowRange(y0, y1);
+
+            cv::remap(_src, band, _maps[0].rowRange(y0, y1), _maps[1].rowRange(y0, y1),
+                      cv::INTER_LINEAR);
+        }
+    }
+
+private:
+    const cv::Mat& _src;
+
+    cv::Mat& _dst;
+
+    const cv::Mat* _maps;
+
+    const int _bands;
+};
+
+}
+
+Undistorter::Undistorter() {
+}
+
+Undistorter::~Undistorter() {
+}
+
+bool Undistorter::load(const std::string& intrinsics, const cv::Size& size, bool cache) {
+    const std::string file = intrinsics + ".map";
+    uint64_t hash = hashFile(intrinsics);
+
+    if (hash == 0) {
+        std::cerr << "Undistorter: cannot open " << intrinsics << std::endl;
+        return false;
+    }
+
+    if (cache && loadCache(file, hash, size)) {
+        std::cout << "Undistorter: loaded maps from " << file << std::endl;
+        return true;
+    }
+
+    cv::Mat cameraMatrix;
+    cv::Mat distCoeffs;
+    cv::FileStorage fs(intrinsics, CV_STORAGE_READ);
+
+    if (!fs.isOpened()) {
+        std::cerr << "Undistorter: cannot open " << intrinsics << std::endl;
+        return false;
+    }
+
+    if (!fs["M"].isNone() && !fs["D"].isNone()) {
+        fs["M"] >> cameraMatrix;
+        fs["D"] >> distCoeffs;
+    } else if (!fs["cameraMatrix"].isNone() && !fs["distCoeffs"].isNone()) {
+        fs["cameraMatrix"] >> cameraMatrix;
+        fs["distCoeffs"] >> distCoeffs;
+    } else {
+        std::cerr << "Undistorter: no intrinsics in " << intrinsics << std::endl;
+        return false;
+    }
+
+    fs.release();
+    std::cout << "Undistorter: cameraMatrix = " << std::endl << cameraMatrix << std::endl;
+    std::cout << "Undistorter: distCoeffs = " << std::endl << distCoeffs << std::endl;
+
+    // CV_16SC2 maps hold integer coordinates and indices of fixed-point
+    // interpolation weights, which cv::remap processes without floats.
+    cv::initUndistortRectifyMap(cameraMatrix, distCoeffs, cv::Mat(), cameraMatrix,
+                                size, CV_16SC2, _maps[0], _maps[1]);
+
+    if (cache)
+        saveCache(file, hash);
+
+    return true;
+}
+
+void Undistorter::undistort(const cv::Mat& src, cv::Mat& dst) const {
+    dst.create(_maps[0].size(), src.type());
+
+    int bands = std::max(1, std::min(cv::getNumThreads(), dst.rows));
+    cv::parallel_for_(cv::Range(0, bands), Remapper(src, dst, _maps, bands));
+}
+
+bool Undistorter::loadCache(const std::string& file, uint64_t hash, const cv::Size& size) {
+    std::ifstream in(file.c_str(), std::ios::binary);
+
+    if (!in)
+        return false;
+
+    char magic[sizeof (MAGIC)];
+    uint64_t cached = 0;
+    int32_t header[2] = { 0, 0 };
+
+    in.read(magic, sizeof (magic));
+    in.read(reinterpret_cast<char*>(&cached), sizeof (cached));
+    in.read(reinterpret_cast<char*>(header), sizeof (header));
+
+    if (!in || std::memcmp(magic, MAGIC, sizeof (MAGIC)) != 0 || cached != hash ||
+        header[0] != size.width || header[1] != size.height)
+        return false;
+
+    _maps[0].create(size, CV_16SC2);
+    _maps[1].create(size, CV_16UC1);
+
+    for (int i = 0; i < 2; i++)
+        in.read(reinterpret_cast<char*>(_maps[i].data), _maps[i].total() * _maps[i].elemSize());
+
+    return (bool) in;
+}
+
+void Undistorter::saveCache(const std::string& file, uint64_t hash) const {
+    std::ofstream out(file.c_str(), std::ios::binary | std::ios::trunc);
+    int32_t header[2] = { _maps[0].cols, _maps[0].rows };
+
+    out.write(MAGIC, sizeof (MAGIC));
+    out.write(reinterpret_cast<const char*>(&hash), sizeof (hash));
+    out.write(reinterpret_cast<const char*>(header), sizeof (header));
+
+    for (int i = 0; i < 2; i++)
+        out.write(reinterpret_cast<const char*>(_maps[i].data),
+                  _maps[i].total() * _maps[i].elemSize());
+
+    if (!out)
+        std::cerr << "Undistorter: cannot write " << file << std::endl;
+}
+
+}
@@ -0,0 +1,29 @@
+/**
+ * @file WhiteBalance.cpp
+ * @author Yutaka Kondo <yutaka.kondo@youtalk.jp>
+ * @date Oct 16, 2026
+ */
+
+#include "rgbd/camera/WhiteBalance.h"
+
+namespace rgbd {
+
+void estimateWhiteBalance(const cv::Mat& gray, double& rscale, double& bscale) {
+    cv::Scalar sum = gray.empty() ? cv::Scalar(1, 1, 1) : cv::sum(gray);
+
+    rscale = sum[2] > 0.0 ? sum[1] / sum[2] : 1.0;
+    bscale = sum[0] > 0.0 ? sum[1] / sum[0] : 1.0;
+}
+
+void buildWhiteBalanceLUT(double rscale, double bscale, cv::Mat& lut) {
+    lut.create(1, 256, CV_8UC3);
+    cv::Vec3b* p = lut.ptr<cv::Vec3b>();
+
+    for (int i = 0; i < 256; i++) {
+        p[i][0] = cv::saturate_cast<uchar>(i * bscale);
+        p[i][1] = (uchar) i;
+        p[i][2] = cv::saturate_cast<uchar>(i * rscale);
+    }
+}
+
+}
@@ -45,18 +45,16 @@
 * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 *******************************************************************************/
 
+#include <algorithm>
 #include "rgbd/camera/ueye_cam_driver.hpp"
 
 using namespace std;
 
 namespace ueye_cam {
 
-int UEyeCamDriver::CAMERA_BUFFER_ID = 1;
-
-UEyeCamDriver::UEyeCamDriver(int cam_ID, string cam_name) :
+UEyeCamDriver::UEyeCamDriver(int cam_ID, string cam_name, unsigned int buffer_count) :
         cam_handle_((HIDS) 0),
-        cam_buffer_(NULL),
-        cam_buffer_id_(CAMERA_BUFFER_ID++),
+        cam_buffer_count_(buffer_count),
         cam_buffer_pitch_(0),
         cam_buffer_size_(0),
         cam_name_(cam_name),
@@ -136,11 +134,14 @@ INT UEyeCamDriver::disconnectCam() {
     if (isConnected()) {
         setStandbyMode();
 
-        // Release existing camera buffers
-        if (cam_buffer_ != NULL) {
-            is_err = is_FreeImageMem(cam_handle_, cam_buffer_, cam_buffer_id_);
+        // Release existing camera buffers, and wait for the locked ones,
+        // which would be freed together with the camera handle
+        freeCamBuffer();
+
+        {
+            std::unique_lock<std::mutex> lock(buffer_mutex_);
+            buffer_unlocked_.wait(lock, [this] { return locked_buffers_.empty(); });
         }
-        cam_buffer_ = NULL;
 
         // Release camera handle
         is_err = is_ExitCamera(cam_handle_);
@@ -892,6 +893,40 @@ INT UEyeCamDriver::setExtTriggerMode() {
     return is_err;
 }
 
+INT UEyeCamDriver::setSoftTriggerMode() {
+    if (!isConnected())
+        return IS_INVALID_CAMERA_HANDLE;
+
+    INT is_err = IS_SUCCESS;
+
+    if (!softTriggerModeActive()) {
+        setStandbyMode(); // No need to check for success
+
+        if ((is_err = is_EnableEvent(cam_handle_, IS_SET_EVENT_FRAME)) != IS_SUCCESS) {
+            std::cerr << "Could not enable frame event for UEye camera '"
+                      << cam_name_ << "' (" << err2str(is_err) << ")" << std::endl;
+            return is_err;
+        }
+
+        if ((is_err = is_SetExternalTrigger(cam_handle_, IS_SET_TRIGGER_SOFTWARE)) != IS_SUCCESS) {
+            std::cerr << "Could not enable software trigger mode on UEye camera '"
+                      << cam_name_ << "' (" << err2str(is_err) << ")" << std::endl;
+            return is_err;
+        }
+        std::cout << "Started software trigger mode on UEye camera '" + cam_name_ + "'"
+                  << std::endl;
+    }
+
+    return is_err;
+}
+
+INT UEyeCamDriver::triggerFrame() {
+    if (!softTriggerModeActive())
+        return IS_NO_SUCCESS;
+
+    return is_FreezeVideo(cam_handle_, IS_DONT_WAIT);
+}
+
 INT UEyeCamDriver::setStandbyMode() {
     if (!isConnected())
         return IS_INVALID_CAMERA_HANDLE;
@@ -918,6 +953,19 @@ INT UEyeCamDriver::setStandbyMode() {
         }
         std::cout << "Stopped external trigger mode on UEye camera '" + cam_name_ + "'"
                   << std::endl;
+    } else if (softTriggerModeActive()) {
+        if ((is_err = is_DisableEvent(cam_handle_, IS_SET_EVENT_FRAME)) != IS_SUCCESS) {
+            std::cerr << "Could not disable frame event for UEye camera '"
+                      << cam_name_ << "' (" << err2str(is_err) << ")" << std::endl;
+            return is_err;
+        }
+        if ((is_err = is_SetExternalTrigger(cam_handle_, IS_SET_TRIGGER_OFF)) != IS_SUCCESS) {
+            std::cerr << "Could not disable software trigger mode on UEye camera '"
+                      << cam_name_ << "' (" << err2str(is_err) << ")" << std::endl;
+            return is_err;
+        }
+        std::cout << "Stopped software trigger mode on UEye camera '" + cam_name_ + "'"
+                  << std::endl;
     } else if (freeRunModeActive()) {
         UINT nMode = IO_FLASH_MODE_OFF;
         if ((is_err = is_IO(cam_handle_, IS_IO_CMD_FLASH_SET_MODE,
@@ -949,8 +997,62 @@ INT UEyeCamDriver::setStandbyMode() {
     return is_err;
 }
 
-const char* UEyeCamDriver::processNextFrame(INT timeout_ms) {
-    if (!freeRunModeActive() && !extTriggerModeActive())
+const char* UEyeCamDriver::processNextFrame(INT timeout_ms, UEYEIMAGEINFO* info) {
+    return waitForNextBuffer(timeout_ms, info);
+}
+
+char* UEyeCamDriver::lockNextFrame(INT timeout_ms, UEYEIMAGEINFO* info) {
+    char* buffer = waitForNextBuffer(timeout_ms, info);
+
+    if (buffer == NULL)
+        return NULL;
+
+    INT is_err = IS_SUCCESS;
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+
+    // The ring buffer may have been reallocated since the frame event
+    if (std::find(cam_buffers_.begin(), cam_buffers_.end(), buffer) == cam_buffers_.end())
+        return NULL;
+
+    if ((is_err = is_LockSeqBuf(cam_handle_, IS_IGNORE_PARAMETER, buffer)) != IS_SUCCESS) {
+        std::cerr << "Failed to lock image buffer of UEye camera '" << cam_name_
+                  << "' (" << err2str(is_err) << ")" << std::endl;
+        return NULL;
+    }
+
+    locked_buffers_.push_back(buffer);
+
+    return buffer;
+}
+
+INT UEyeCamDriver::unlockFrame(char* buffer) {
+    INT is_err = IS_SUCCESS;
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+    auto locked = std::find(locked_buffers_.begin(), locked_buffers_.end(), buffer);
+
+    if (locked == locked_buffers_.end())
+        return IS_INVALID_PARAMETER;
+
+    locked_buffers_.erase(locked);
+    auto retired = std::find_if(retired_buffers_.begin(), retired_buffers_.end(),
+                                [buffer](const std::pair<char*, int>& it) {
+        return it.first == buffer;
+    });
+
+    if (retired != retired_buffers_.end()) {
+        is_err = is_FreeImageMem(cam_handle_, retired->first, retired->second);
+        retired_buffers_.erase(retired);
+    } else {
+        is_err = is_UnlockSeqBuf(cam_handle_, IS_IGNORE_PARAMETER, buffer);
+    }
+
+    buffer_unlocked_.notify_all();
+
+    return is_err;
+}
+
+char* UEyeCamDriver::waitForNextBuffer(INT timeout_ms, UEYEIMAGEINFO* info) {
+    if (!freeRunModeActive() && !extTriggerModeActive() && !softTriggerModeActive())
         return NULL;
 
     INT is_err = IS_SUCCESS;
@@ -962,7 +1064,33 @@ const char* UEyeCamDriver::processNextFrame(INT timeout_ms) {
         return NULL;
     }
 
-    return cam_buffer_;
+    // The last completed image memory of the ring buffer holds the new frame
+    INT num = 0;
+    char* active = NULL;
+    char* last = NULL;
+
+    if ((is_err = is_GetActSeqBuf(cam_handle_, &num, &active, &last)) != IS_SUCCESS) {
+        std::cerr << "Failed to query active image buffer of UEye camera '" << cam_name_
+                  << "' (" << err2str(is_err) << ")" << std::endl;
+        return NULL;
+    }
+
+    if (info != NULL) {
+        size_t i = 0;
+
+        while (i < cam_buffers_.size() && cam_buffers_[i] != last)
+            i++;
+
+        if (i == cam_buffers_.size() ||
+            (is_err = is_GetImageInfo(cam_handle_, cam_buffer_ids_[i], info, sizeof (UEYEIMAGEINFO)))
+            != IS_SUCCESS) {
+            std::cerr << "Failed to query image info from UEye camera '" << cam_name_
+                      << "' (" << err2str(is_err) << ")" << std::endl;
+            memset(info, 0, sizeof (UEYEIMAGEINFO));
+        }
+    }
+
+    return last;
 }
 
 INT UEyeCamDriver::reallocateCamBuffer() {
@@ -970,26 +1098,40 @@ INT UEyeCamDriver::reallocateCamBuffer() {
 
     // Stop capture to prevent access to memory buffer
     setStandbyMode();
+    freeCamBuffer();
 
-    if (cam_buffer_ != NULL) {
-        is_err = is_FreeImageMem(cam_handle_, cam_buffer_, cam_buffer_id_);
-        cam_buffer_ = NULL;
-    }
     INT width = cam_aoi_.s32Width /
             (cam_sensor_scaling_rate_ * cam_subsampling_rate_ * cam_binning_rate_);
     INT height = cam_aoi_.s32Height /
             (cam_sensor_scaling_rate_ * cam_subsampling_rate_ * cam_binning_rate_);
-    if ((is_err = is_AllocImageMem(cam_handle_, width, height, bits_per_pixel_,
-                                   &cam_buffer_, &cam_buffer_id_))
-        != IS_SUCCESS) {
-        std::cerr << "Failed to allocate " << width << " x " << height
-                  << " image buffer" << std::endl;
-        return is_err;
-    }
-    if ((is_err = is_SetImageMem(cam_handle_, cam_buffer_, cam_buffer_id_)) != IS_SUCCESS) {
-        std::cerr << "Failed to associate an image buffer to the UEye camera driver" << std::endl;
-        return is_err;
+
+    // Allocate a ring of image memories, so that the camera writes the next
+    // frame into a free memory while the previous ones are still being read
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex_);
+
+        for (unsigned int i = 0; i < cam_buffer_count_; i++) {
+            char* buffer = NULL;
+            int id = 0;
+
+            if ((is_err = is_AllocImageMem(cam_handle_, width, height, bits_per_pixel_,
+                                           &buffer, &id))
+                != IS_SUCCESS) {
+                std::cerr << "Failed to allocate " << width << " x " << height
+                          << " image buffer" << std::endl;
+                return is_err;
+            }
+            cam_buffers_.push_back(buffer);
+            cam_buffer_ids_.push_back(id);
+
+            if ((is_err = is_AddToSequence(cam_handle_, buffer, id)) != IS_SUCCESS) {
+                std::cerr << "Failed to add an image buffer to the UEye camera ring buffer"
+                          << std::endl;
+                return is_err;
+            }
+        }
     }
+
     if ((is_err = is_GetImageMemPitch(cam_handle_, &cam_buffer_pitch_)) != IS_SUCCESS) {
         std::cerr << "Failed to query UEye camera buffer's pitch (a.k.a. stride)" << std::endl;
         return is_err;
@@ -998,11 +1140,31 @@ INT UEyeCamDriver::reallocateCamBuffer() {
     std::cout << "Allocate internal memory - width: " << width << "; height: "
               << height << "; fetched pitch: " << cam_buffer_pitch_
               << "; expected bpp: " << bits_per_pixel_ << "; total size: "
-              << cam_buffer_size_ << std::endl;
+              << cam_buffer_size_ << " x " << cam_buffer_count_ << std::endl;
 
     return is_err;
 }
 
+void UEyeCamDriver::freeCamBuffer() {
+    std::lock_guard<std::mutex> lock(buffer_mutex_);
+
+    if (!cam_buffers_.empty())
+        is_ClearSequence(cam_handle_);
+
+    // Locked memories may still be read through frames, so they are freed
+    // once they are unlocked
+    for (size_t i = 0; i < cam_buffers_.size(); i++) {
+        if (std::find(locked_buffers_.begin(), locked_buffers_.end(), cam_buffers_[i])
+            != locked_buffers_.end())
+            retired_buffers_.push_back(std::make_pair(cam_buffers_[i], cam_buffer_ids_[i]));
+        else
+            is_FreeImageMem(cam_handle_, cam_buffers_[i], cam_buffer_ids_[i]);
+    }
+
+    cam_buffers_.clear();
+    cam_buffer_ids_.clear();
+}
+
 cv::Size UEyeCamDriver::getCameraSize() const {
     INT width = cam_aoi_.s32Width /
             (cam_sensor_scaling_rate_ * cam_subsampling_rate_ * cam_binning_rate_);